@@ -18,6 +18,7 @@
 #include <ready_trader_go/logging.h>
 
 #include <array>
+#include <cstddef>
 #include <boost/asio/io_context.hpp>
 #include <iostream>
 
@@ -32,7 +33,27 @@ constexpr int TICK_SIZE_IN_CENTS = 100;
 constexpr int MIN_BID_NEAREST_TICK = (MINIMUM_BID + TICK_SIZE_IN_CENTS) / TICK_SIZE_IN_CENTS * TICK_SIZE_IN_CENTS;
 constexpr int MAX_ASK_NEAREST_TICK = MAXIMUM_ASK / TICK_SIZE_IN_CENTS * TICK_SIZE_IN_CENTS;
 
-AutoTrader::AutoTrader(boost::asio::io_context& context): BaseAutoTrader(context) {}
+// key for the hedges waiting in the scheduler
+constexpr unsigned long HEDGE_KEY = 1;
+
+// spread each side's volume over this many levels, a tick apart, with any
+// remainder on the inside level
+constexpr std::size_t QUOTE_LEVEL_COUNT = 2;
+
+static std::array<QuoteLevel, QUOTE_LEVEL_COUNT> makeLadder(Side side, unsigned long price, unsigned long volume) {
+    std::array<QuoteLevel, QUOTE_LEVEL_COUNT> ladder;
+    for (std::size_t i = 0; i != QUOTE_LEVEL_COUNT; ++i) {
+        unsigned long offset = i * TICK_SIZE_IN_CENTS;
+        ladder[i].mPrice = (side == Side::SELL) ? price + offset : price - offset;
+        ladder[i].mVolume = volume / QUOTE_LEVEL_COUNT + ((i == 0) ? volume % QUOTE_LEVEL_COUNT : 0);
+        if (ladder[i].mPrice < MIN_BID_NEAREST_TICK || ladder[i].mPrice > MAX_ASK_NEAREST_TICK) {
+            ladder[i].mVolume = 0;
+        }
+    }
+    return ladder;
+}
+
+AutoTrader::AutoTrader(boost::asio::io_context& context): BaseAutoTrader(context), mQuotes(*this) {}
 
 void AutoTrader::DisconnectHandler() {
     BaseAutoTrader::DisconnectHandler();
@@ -40,11 +61,8 @@ void AutoTrader::DisconnectHandler() {
 }
 
 void AutoTrader::ErrorMessageHandler(unsigned long clientOrderId, const std::string& errorMessage) {
+    // a rejected quote is no longer live, so the next book update replaces it
     RLOG(LG_AT, LogLevel::LL_INFO) << "error with order " << clientOrderId << ": " << errorMessage;
-    if (clientOrderId != 0 && ((mAsks.count(clientOrderId) == 1) ||
-                               (mBids.count(clientOrderId) == 1))) {
-        OrderStatusMessageHandler(clientOrderId, 0, 0, 0);
-    }
 }
 
 void AutoTrader::HedgeFilledMessageHandler(unsigned long clientOrderId,
@@ -52,48 +70,38 @@ void AutoTrader::HedgeFilledMessageHandler(unsigned long clientOrderId,
                                            unsigned long volume) {
 }
 
-void AutoTrader::OrderBookMessageHandler(
-    Instrument instrument, unsigned long sequenceNumber,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& askPrices,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& askVolumes,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& bidPrices,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& bidVolumes) {
+void AutoTrader::OrderBookMessageHandler(const OrderBookView& book) {
     // Use FUTURE (liquid order book) prices to set prices for ETF (illiquid
     // order book)
-    if (instrument == Instrument::FUTURE) {
-
+    if (book.GetInstrument() == Instrument::FUTURE) {
+        // send the cancels and inserts below as a single burst
+        SendBatch batch(*this);
+
+        // try again to hedge whatever earlier hedges were refused for; a
+        // refusal now adds it back to mUnhedged
+        signed long unhedged = mUnhedged;
+        mUnhedged = 0;
+        if (unhedged > 0) {
+            ScheduleHedgeOrder(HEDGE_KEY, Side::BUY, MAX_ASK_NEAREST_TICK, unhedged);
+        } else if (unhedged < 0) {
+            ScheduleHedgeOrder(HEDGE_KEY, Side::SELL, MIN_BID_NEAREST_TICK, -unhedged);
+        }
 
         // set bid / ask price + transaction fee
-        unsigned long newAskPrice = askPrices[0] + TICK_SIZE_IN_CENTS;
-        unsigned long newBidPrice = bidPrices[0] - TICK_SIZE_IN_CENTS;
-
-
-        // cancel existing order if price set is different from previous setted price
-        if (mAskId != 0 && newAskPrice != 0 && newAskPrice != mAskPrice) {  
-            SendCancelOrder(mAskId);
-            mAskId = 0;
-        }
-        if (mBidId != 0 && newBidPrice != mBidPrice) {  
-            SendCancelOrder(mBidId);
-            mBidId = 0;
-        }
+        unsigned long newAskPrice = book.GetAskPrice(0) + TICK_SIZE_IN_CENTS;
+        unsigned long newBidPrice = book.GetBidPrice(0) - TICK_SIZE_IN_CENTS;
 
         unsigned long askVolume = (POSITION_LIMIT + mPosition) / 2;
         unsigned long bidVolume = TICK_SIZE_IN_CENTS - askVolume;
-            
-        // create new order with the new setted price
-        // should only have 1 order for buy / sell each
-        if (mAskId == 0 && askVolume) {
-            SendInsertOrder(++mNextMessageId, Side::SELL, newAskPrice, askVolume, Lifespan::GOOD_FOR_DAY);
-            mAskPrice = newAskPrice;
-            mAskId = mNextMessageId;
-            mAsks.emplace(mAskId);
+
+        // move our quotes to the new ladders; prices that haven't changed
+        // keep their orders (and queue priority), and volume that has
+        // only shrunk is amended rather than cancelled and re-inserted
+        if (book.GetAskPrice(0) != 0) {
+            mQuotes.SetQuotes(Side::SELL, makeLadder(Side::SELL, newAskPrice, askVolume));
         }
-        if (mBidId == 0 && bidVolume) {
-            SendInsertOrder(++mNextMessageId, Side::BUY, newBidPrice, bidVolume, Lifespan::GOOD_FOR_DAY);
-            mBidPrice = newBidPrice;
-            mBidId = mNextMessageId;
-            mBids.emplace(mBidId);
+        if (book.GetBidPrice(0) != 0) {
+            mQuotes.SetQuotes(Side::BUY, makeLadder(Side::BUY, newBidPrice, bidVolume));
         }
     }
 }
@@ -104,12 +112,16 @@ void AutoTrader::OrderFilledMessageHandler(unsigned long clientOrderId,
                                            unsigned long volume) {
 
     // hedge order when order is filled
-    if (mAsks.count(clientOrderId)) {
+    const Order* order = GetOrders().Find(clientOrderId);
+    if (!order || order->mIsHedge) {
+        return;
+    }
+    if (order->mSide == Side::SELL) {
         mPosition -= (long)volume;
-        SendHedgeOrder(++mNextMessageId, Side::BUY, MAX_ASK_NEAREST_TICK,volume);
-    } else if (mBids.count(clientOrderId)) {
+        ScheduleHedgeOrder(HEDGE_KEY, Side::BUY, MAX_ASK_NEAREST_TICK,volume);
+    } else {
         mPosition += (long)volume;
-        SendHedgeOrder(++mNextMessageId, Side::SELL, MIN_BID_NEAREST_TICK,volume);
+        ScheduleHedgeOrder(HEDGE_KEY, Side::SELL, MIN_BID_NEAREST_TICK,volume);
     }
 }
 
@@ -117,22 +129,15 @@ void AutoTrader::OrderStatusMessageHandler(unsigned long clientOrderId,
                                            unsigned long fillVolume,
                                            unsigned long remainingVolume,
                                            signed long fees) {
-    if (remainingVolume == 0) {
-        if (clientOrderId == mAskId) {
-            mAskId = 0;
-        } else if (clientOrderId == mBidId) {
-            mBidId = 0;
-        }
+}
 
-        mAsks.erase(clientOrderId);
-        mBids.erase(clientOrderId);
-    }
+void AutoTrader::TradeTicksMessageHandler(const TradeTicksView& ticks) {
 }
 
-void AutoTrader::TradeTicksMessageHandler(
-    Instrument instrument, unsigned long sequenceNumber,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& askPrices,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& askVolumes,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& bidPrices,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& bidVolumes) {
+void AutoTrader::ScheduledOrderSentHandler(unsigned long key, const OrderCommand& command) {
+    // a refused hedge is retried on the next future book update, as
+    // scheduling from here isn't allowed
+    if (command.mType == OrderCommandType::HEDGE && command.mClientOrderId == 0) {
+        mUnhedged += (command.mSide == Side::BUY) ? (long)command.mVolume : -(long)command.mVolume;
+    }
 }
@@ -21,12 +21,12 @@
 #include <array>
 #include <memory>
 #include <string>
-#include <unordered_set>
 #include <deque>
 
 #include <boost/asio/io_context.hpp>
 
 #include <ready_trader_go/baseautotrader.h>
+#include <ready_trader_go/quotemanager.h>
 #include <ready_trader_go/types.h>
 
 class AutoTrader : public ReadyTraderGo::BaseAutoTrader
@@ -58,13 +58,8 @@ public:
     // The sequence number can be used to detect missed or out-of-order
     // messages. The five best available ask (i.e. sell) and bid (i.e. buy)
     // prices are reported along with the volume available at each of those
-    // price levels.
-    void OrderBookMessageHandler(ReadyTraderGo::Instrument instrument,
-                                 unsigned long sequenceNumber,
-                                 const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askPrices,
-                                 const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askVolumes,
-                                 const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidPrices,
-                                 const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidVolumes) override;
+    // price levels. Fields are read from the message as they are accessed.
+    void OrderBookMessageHandler(const ReadyTraderGo::OrderBookView& book) override;
 
     // Called when one of your orders is filled, partially or fully.
     void OrderFilledMessageHandler(unsigned long clientOrderId,
@@ -87,31 +82,22 @@ public:
     // traded at each of those price levels.
     // If there are less than five prices on a side, then zeros will appear at
     // the end of both the prices and volumes arrays.
-    void TradeTicksMessageHandler(ReadyTraderGo::Instrument instrument,
-                                  unsigned long sequenceNumber,
-                                  const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askPrices,
-                                  const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askVolumes,
-                                  const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidPrices,
-                                  const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidVolumes) override;
+    void TradeTicksMessageHandler(const ReadyTraderGo::TradeTicksView& ticks) override;
 
-private:
-    unsigned long mNextMessageId = 1;
+    // Called when a scheduled hedge is sent, or refused with a zero id.
+    void ScheduledOrderSentHandler(unsigned long key, const ReadyTraderGo::OrderCommand& command) override;
 
-    unsigned long mAskId = 0;
-    unsigned long mAskPrice = 0;
-    unsigned long mBidId = 0;
-    unsigned long mBidPrice = 0;
+private:
+    ReadyTraderGo::QuoteManager<AutoTrader> mQuotes;
 
     unsigned long newAskPrice = 0;
     unsigned long newBidPrice = 0;
 
     signed long mPosition = 0;
+    signed long mUnhedged = 0; // lots of refused hedges, positive to buy
     
     bool allowBuy = true;
     bool allowSell = true;
-
-    std::unordered_set<unsigned long> mAsks;
-    std::unordered_set<unsigned long> mBids;
 };
 
 #endif //CPPREADY_TRADER_GO_AUTOTRADER_H
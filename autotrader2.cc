@@ -25,8 +25,8 @@ void AutoTrader::DisconnectHandler() {
 
 void AutoTrader::ErrorMessageHandler(unsigned long clientOrderId, const std::string& errorMessage) {
     RLOG(LG_AT, LogLevel::LL_INFO) << "error with order " << clientOrderId << ": " << errorMessage;
-    if (clientOrderId != 0 && ((mAsks.count(clientOrderId) == 1) ||
-                               (mBids.count(clientOrderId) == 1))) {
+    const Order* order = GetOrders().Find(clientOrderId);
+    if (clientOrderId != 0 && order && !order->mIsHedge && order->mStatus != OrderStatus::LIVE) {
         OrderStatusMessageHandler(clientOrderId, 0, 0, 0);
     }
 }
@@ -35,29 +35,28 @@ void AutoTrader::HedgeFilledMessageHandler(unsigned long clientOrderId,
                                            unsigned long price,
                                            unsigned long volume) {
     
-    if (mAsks.count(clientOrderId)){
+    const Order* order = GetOrders().Find(clientOrderId);
+    if (!order || !order->mIsHedge) {
+        return;
+    }
+    if (order->mSide == Side::BUY){
         std::cout << "Hedge bought at " << price << std::endl;
         mPosition += volume;
         lastBuyPrice = price;
     }
-    else if (mBids.count(clientOrderId)){
+    else {
         std::cout << "Hedge sold at " << price << std::endl;
         std::cout << "Profit: " <<  (double) price - (double) lastBuyPrice << std::endl <<std::endl;
         mPosition -= volume;
     }
 }
 
-void AutoTrader::OrderBookMessageHandler(
-    Instrument instrument, unsigned long sequenceNumber,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& askPrices,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& askVolumes,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& bidPrices,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& bidVolumes) {
+void AutoTrader::OrderBookMessageHandler(const OrderBookView& book) {
 
-    if(instrument == Instrument::FUTURE){
+    if(book.GetInstrument() == Instrument::FUTURE){
 
-        unsigned long askPrice = askPrices[0];
-        unsigned long bidPrice = bidPrices[0];
+        unsigned long askPrice = book.GetAskPrice(0);
+        unsigned long bidPrice = book.GetBidPrice(0);
         
         AddEntry(bidPrice, askPrice);
 
@@ -84,12 +83,10 @@ void AutoTrader::InsertOrderWhenPossibleToBuy(unsigned long askPrice){
 
 void AutoTrader::Buy(unsigned long askPrice, unsigned long volume, ReadyTraderGo::Lifespan lifespan){
     SendHedgeOrder(++mNextMessageId, Side::BUY, askPrice,volume);
-    mAsks.emplace(mNextMessageId);
 }
 
 void AutoTrader::Sell(unsigned long bidPrice, unsigned long volume, ReadyTraderGo::Lifespan lifespan){
     SendHedgeOrder(++mNextMessageId, Side::SELL, bidPrice,volume);
-    mBids.emplace(mNextMessageId);
 }
 
 void AutoTrader::AddEntry(unsigned long buyPrice, unsigned long sellPrice){
@@ -211,10 +208,14 @@ void AutoTrader::OrderFilledMessageHandler(unsigned long clientOrderId,
 
     // hedge order when order is filled
     std::cout << "Order filled at " << price << std::endl;
-    if (mAsks.count(clientOrderId)) {
+    const Order* order = GetOrders().Find(clientOrderId);
+    if (!order || order->mIsHedge) {
+        return;
+    }
+    if (order->mSide == Side::SELL) {
         mPosition -= (long)volume;
         SendHedgeOrder(++mNextMessageId, Side::BUY, MAX_ASK_NEAREST_TICK,volume);
-    } else if (mBids.count(clientOrderId)) {
+    } else {
         mPosition += (long)volume;
         SendHedgeOrder(++mNextMessageId, Side::SELL, MIN_BID_NEAREST_TICK,volume);
     }
@@ -230,16 +231,8 @@ void AutoTrader::OrderStatusMessageHandler(unsigned long clientOrderId,
         } else if (clientOrderId == mBidId) {
             mBidId = 0;
         }
-
-        mAsks.erase(clientOrderId);
-        mBids.erase(clientOrderId);
     }
 }
 
-void AutoTrader::TradeTicksMessageHandler(
-    Instrument instrument, unsigned long sequenceNumber,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& askPrices,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& askVolumes,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& bidPrices,
-    const std::array<unsigned long, TOP_LEVEL_COUNT>& bidVolumes) {
+void AutoTrader::TradeTicksMessageHandler(const TradeTicksView& ticks) {
 }
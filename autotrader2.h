@@ -21,7 +21,6 @@
 #include <array>
 #include <memory>
 #include <string>
-#include <unordered_set>
 #include <set>
 
 #include <boost/asio/io_context.hpp>
@@ -58,13 +57,8 @@ public:
     // The sequence number can be used to detect missed or out-of-order
     // messages. The five best available ask (i.e. sell) and bid (i.e. buy)
     // prices are reported along with the volume available at each of those
-    // price levels.
-    void OrderBookMessageHandler(ReadyTraderGo::Instrument instrument,
-                                 unsigned long sequenceNumber,
-                                 const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askPrices,
-                                 const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askVolumes,
-                                 const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidPrices,
-                                 const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidVolumes) override;
+    // price levels. Fields are read from the message as they are accessed.
+    void OrderBookMessageHandler(const ReadyTraderGo::OrderBookView& book) override;
 
     // Called when one of your orders is filled, partially or fully.
     void OrderFilledMessageHandler(unsigned long clientOrderId,
@@ -87,12 +81,7 @@ public:
     // traded at each of those price levels.
     // If there are less than five prices on a side, then zeros will appear at
     // the end of both the prices and volumes arrays.
-    void TradeTicksMessageHandler(ReadyTraderGo::Instrument instrument,
-                                  unsigned long sequenceNumber,
-                                  const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askPrices,
-                                  const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askVolumes,
-                                  const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidPrices,
-                                  const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidVolumes) override;
+    void TradeTicksMessageHandler(const ReadyTraderGo::TradeTicksView& ticks) override;
 
     
     unsigned long CalcConversionLine(std::deque<unsigned long> &prices);
@@ -136,9 +125,6 @@ private:
     std::deque<unsigned long> buyPrices;
     std::deque<unsigned long> sellPrices;
 
-    std::unordered_set<unsigned long> mAsks;
-    std::unordered_set<unsigned long> mBids;
-
     unsigned long buyPrice = 0;
     unsigned long sellPrice = 0;
 
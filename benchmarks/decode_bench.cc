@@ -0,0 +1,131 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include <ready_trader_go/protocol.h>
+
+using namespace ReadyTraderGo;
+
+// Compare OrderBookMessage::Deserialise, which uses the SSSE3 or AVX2 level
+// decoder when the build allows it (see RTG_NATIVE_ARCH), with a plain
+// field-by-field decode of the same messages.
+
+constexpr std::size_t MESSAGE_COUNT = 64;
+constexpr unsigned long ITERATIONS = 50'000'000;
+
+static void DecodeScalar(OrderBookMessage& message, unsigned char const* data)
+{
+    message.mInstrument = Instrument(*data++);
+    LongField::Read(data, message.mSequenceNumber);
+    data += MessageFieldSize::LONG;
+    for (auto* levels : {&message.mAskPrices, &message.mAskVolumes, &message.mBidPrices, &message.mBidVolumes})
+    {
+        for (auto& level : *levels)
+        {
+            LongField::Read(data, level);
+            data += MessageFieldSize::LONG;
+        }
+    }
+}
+
+static unsigned long Checksum(const OrderBookMessage& message)
+{
+    unsigned long sum = message.mSequenceNumber;
+    for (std::size_t i = 0; i < TOP_LEVEL_COUNT; ++i)
+    {
+        sum += message.mAskPrices[i] ^ message.mAskVolumes[i] ^ message.mBidPrices[i] ^ message.mBidVolumes[i];
+    }
+    return sum;
+}
+
+template<typename Decode>
+static double Run(const char* name, const std::vector<unsigned char>& wire, std::size_t size, Decode&& decode)
+{
+    OrderBookMessage message;
+    unsigned long checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < ITERATIONS; ++i)
+    {
+        decode(message, wire.data() + (i % MESSAGE_COUNT) * size);
+        checksum += Checksum(message);
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    const double perMessage = elapsed.count() / ITERATIONS;
+    std::printf("%-12s %6.2f ns/msg (checksum %lu)\n", name, perMessage, checksum);
+    return perMessage;
+}
+
+int main()
+{
+    const std::size_t size = MessageTraits<OrderBookMessage>::Schema::SIZE;
+    std::vector<unsigned char> wire(MESSAGE_COUNT * size);
+    std::vector<OrderBookMessage> messages(MESSAGE_COUNT);
+    for (std::size_t m = 0; m < MESSAGE_COUNT; ++m)
+    {
+        auto& message = messages[m];
+        message.mSequenceNumber = m + 1;
+        for (std::size_t i = 0; i < TOP_LEVEL_COUNT; ++i)
+        {
+            message.mAskPrices[i] = 100'000 + m * 100 + i * 100;
+            message.mAskVolumes[i] = 0x01020304ul * (i + 1) + m;
+            message.mBidPrices[i] = 99'900 + m * 100 - i * 100;
+            message.mBidVolumes[i] = 0xfedcba98ul - i - m;
+        }
+        message.Serialise(wire.data() + m * size);
+    }
+
+    // Check both decoders agree with what was serialised before timing them.
+    for (std::size_t m = 0; m < MESSAGE_COUNT; ++m)
+    {
+        OrderBookMessage simd;
+        OrderBookMessage scalar;
+        simd.Deserialise(wire.data() + m * size, size);
+        DecodeScalar(scalar, wire.data() + m * size);
+        const auto& expected = messages[m];
+        for (const auto* decoded : {&simd, &scalar})
+        {
+            if (decoded->mSequenceNumber != expected.mSequenceNumber
+                || decoded->mAskPrices != expected.mAskPrices || decoded->mAskVolumes != expected.mAskVolumes
+                || decoded->mBidPrices != expected.mBidPrices || decoded->mBidVolumes != expected.mBidVolumes)
+            {
+                std::fprintf(stderr, "decoded message %zu does not match\n", m);
+                return 1;
+            }
+        }
+    }
+
+#if defined(__AVX2__)
+    std::puts("level decoder: AVX2");
+#elif defined(__SSSE3__)
+    std::puts("level decoder: SSSE3");
+#else
+    std::puts("level decoder: scalar (configure with -DRTG_NATIVE_ARCH=ON to vectorise)");
+#endif
+
+    // Call the scalar decoder out of line, as Deserialise is, so that only
+    // the decoding itself differs.
+    void (*volatile decodeScalar)(OrderBookMessage&, unsigned char const*) = DecodeScalar;
+    const double scalar = Run("scalar", wire, size, decodeScalar);
+    const double deserialise = Run("Deserialise", wire, size, [size](OrderBookMessage& message, unsigned char const* data) {
+        message.Deserialise(data, size);
+    });
+    std::printf("speedup      %6.2fx\n", scalar / deserialise);
+    return 0;
+}
@@ -0,0 +1,180 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/log/core.hpp>
+
+#include <ready_trader_go/baseautotrader.h>
+#include <ready_trader_go/protocol.h>
+
+using namespace ReadyTraderGo;
+
+// The cost of delivering one execution or information message to an
+// auto-trader's handler, from the transport's callback onwards, for:
+//   virtual - BaseAutoTrader with the array-based book handler, which is
+//             what every auto-trader used before BaseAutoTraderT;
+//   view    - BaseAutoTrader with the view-based book handler; and
+//   static  - BaseAutoTraderT, whose handlers are bound at compile time.
+
+constexpr unsigned long ITERATIONS = 50'000'000;
+
+// A connection or subscription that goes nowhere; messages are delivered by
+// calling MessageReceived directly.
+struct NullConnection : IConnection
+{
+    void AsyncRead() override {}
+    void SendMessage(unsigned char, const ISerialisable&, SendMode) override {}
+    void SendFrame(unsigned char const*, std::size_t, SendMode) override {}
+    void Flush() override {}
+};
+
+struct NullSubscription : ISubscription
+{
+    void AsyncReceive() override {}
+    std::size_t Poll() override { return 0; }
+};
+
+class VirtualTrader : public BaseAutoTrader
+{
+public:
+    using BaseAutoTrader::BaseAutoTrader;
+    unsigned long mSum = 0;
+
+protected:
+    void OrderBookMessageHandler(Instrument instrument,
+                                 unsigned long sequenceNumber,
+                                 const std::array<unsigned long, TOP_LEVEL_COUNT>& askPrices,
+                                 const std::array<unsigned long, TOP_LEVEL_COUNT>& askVolumes,
+                                 const std::array<unsigned long, TOP_LEVEL_COUNT>& bidPrices,
+                                 const std::array<unsigned long, TOP_LEVEL_COUNT>& bidVolumes) override
+    {
+        mSum += sequenceNumber + askPrices[0] + bidPrices[0];
+    }
+
+    void OrderStatusMessageHandler(unsigned long clientOrderId,
+                                   unsigned long fillVolume,
+                                   unsigned long remainingVolume,
+                                   signed long fees) override
+    {
+        mSum += clientOrderId + remainingVolume;
+    }
+};
+
+class ViewTrader : public BaseAutoTrader
+{
+public:
+    using BaseAutoTrader::BaseAutoTrader;
+    unsigned long mSum = 0;
+
+protected:
+    void OrderBookMessageHandler(const OrderBookView& book) override
+    {
+        mSum += book.GetSequenceNumber() + book.GetAskPrice(0) + book.GetBidPrice(0);
+    }
+
+    void OrderStatusMessageHandler(unsigned long clientOrderId,
+                                   unsigned long fillVolume,
+                                   unsigned long remainingVolume,
+                                   signed long fees) override
+    {
+        mSum += clientOrderId + remainingVolume;
+    }
+};
+
+class StaticTrader : public BaseAutoTraderT<StaticTrader>
+{
+public:
+    using BaseAutoTraderT::BaseAutoTraderT;
+    unsigned long mSum = 0;
+
+private:
+    friend class BaseAutoTraderT<StaticTrader>;
+
+    void OrderBookMessageHandler(const OrderBookView& book)
+    {
+        mSum += book.GetSequenceNumber() + book.GetAskPrice(0) + book.GetBidPrice(0);
+    }
+
+    void OrderStatusMessageHandler(unsigned long clientOrderId,
+                                   unsigned long fillVolume,
+                                   unsigned long remainingVolume,
+                                   signed long fees)
+    {
+        mSum += clientOrderId + remainingVolume;
+    }
+};
+
+template<typename M>
+static std::array<unsigned char, messageSize<M>()> encode(const M& message)
+{
+    std::array<unsigned char, messageSize<M>()> frame;
+    encodeMessage(message, frame.data());
+    return frame;
+}
+
+template<typename Trader>
+static void run(const char* name)
+{
+    boost::asio::io_context context;
+    Trader trader{context};
+    auto connection = std::make_unique<NullConnection>();
+    auto subscription = std::make_shared<NullSubscription>();
+    IConnection* exec = connection.get();
+    ISubscription* info = subscription.get();
+    trader.SetExecutionConnection(std::move(connection));
+    trader.SetInformationSubscription(std::move(subscription));
+
+    const auto status = encode(OrderStatusMessage{1, 0, 10, 0});
+    const auto book = encode(OrderBookMessage{Instrument::ETF, 1, {100'100, 100'200, 100'300, 100'400, 100'500},
+                                              {10, 20, 30, 40, 50}, {100'000, 99'900, 99'800, 99'700, 99'600},
+                                              {10, 20, 30, 40, 50}});
+
+    auto time = [](auto&& deliver) {
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned long i = 0; i < ITERATIONS; ++i)
+        {
+            deliver();
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / ITERATIONS;
+    };
+
+    const double statusTime = time([&] {
+        exec->MessageReceived(exec, MessageTraits<OrderStatusMessage>::TYPE, status.data() + MESSAGE_HEADER_SIZE,
+                              status.size() - MESSAGE_HEADER_SIZE);
+    });
+    const double bookTime = time([&] {
+        info->MessageReceived(info, MessageTraits<OrderBookMessage>::TYPE, book.data() + MESSAGE_HEADER_SIZE,
+                              book.size() - MESSAGE_HEADER_SIZE);
+    });
+    std::printf("%-8s order status %5.2f ns/msg, book update %5.2f ns/msg (checksum %lu)\n", name, statusTime,
+                bookTime, trader.mSum);
+}
+
+int main()
+{
+    boost::log::core::get()->set_logging_enabled(false);
+    run<VirtualTrader>("virtual");
+    run<ViewTrader>("view");
+    run<StaticTrader>("static");
+    return 0;
+}
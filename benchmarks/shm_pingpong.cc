@@ -0,0 +1,210 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/endian/conversion.hpp>
+
+#include <ready_trader_go/error.h>
+#include <ready_trader_go/protocol.h>
+#include <ready_trader_go/shmconnection.h>
+
+using namespace ReadyTraderGo;
+using boost::asio::ip::tcp;
+
+// Round-trip latency of an insert order frame over the shared-memory
+// execution channel and over loopback TCP. In each case a second thread
+// echoes every frame straight back. Both shared-memory threads spin,
+// yielding the CPU between polls so that the benchmark still makes progress
+// on a single core.
+
+using Clock = std::chrono::steady_clock;
+
+constexpr unsigned long ROUND_TRIPS = 20'000;
+constexpr unsigned long WARM_UP = 1'000;
+
+struct Result
+{
+    std::vector<double> mRoundTrips;
+    std::vector<double> mSends;
+};
+
+static std::array<unsigned char, MESSAGE_HEADER_SIZE + MessageTraits<InsertMessage>::Schema::SIZE> makeFrame()
+{
+    std::array<unsigned char, MESSAGE_HEADER_SIZE + MessageTraits<InsertMessage>::Schema::SIZE> frame;
+    const InsertMessage insert{1, Side::BUY, 100'000, 10, Lifespan::GOOD_FOR_DAY};
+    *(uint16_t*)frame.data() = boost::endian::native_to_big((uint16_t)frame.size());
+    frame[MESSAGE_TYPE_OFFSET] = MessageTraits<InsertMessage>::TYPE;
+    insert.Serialise(frame.data() + MESSAGE_HEADER_SIZE);
+    return frame;
+}
+
+static double microseconds(Clock::duration d)
+{
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+static void report(const char* name, Result& result)
+{
+    auto percentile = [](std::vector<double>& samples, double p) {
+        const auto nth = samples.begin() + (std::ptrdiff_t)(p * (double)(samples.size() - 1));
+        std::nth_element(samples.begin(), nth, samples.end());
+        return *nth;
+    };
+    const double p50 = percentile(result.mRoundTrips, 0.5);
+    const double p99 = percentile(result.mRoundTrips, 0.99);
+    const double send = percentile(result.mSends, 0.5);
+    std::printf("%-4s round trip p50 %6.2f us, p99 %6.2f us; send p50 %5.2f us\n", name, p50, p99, send);
+}
+
+static Result pingPongShm(const std::string& name)
+{
+    ShmChannel channel{name, MINIMUM_SHM_RING_SIZE};
+    const auto frame = makeFrame();
+
+    std::thread echo([&channel] {
+        ShmRing in = channel.GetRing(TO_EXCHANGE);
+        ShmRing out = channel.GetRing(FROM_EXCHANGE);
+        while (!in.IsClosed())
+        {
+            const std::size_t count = in.Consume([&out](unsigned char const* data, std::size_t size) {
+                unsigned char* reply;
+                while ((reply = out.Prepare(size)) == nullptr)
+                {
+                    sched_yield();
+                }
+                std::memcpy(reply, data, size);
+                out.Commit(size);
+            });
+            if (count != 0)
+            {
+                out.Publish();
+            }
+            else
+            {
+                sched_yield();
+            }
+        }
+    });
+
+    ShmRing out = channel.GetRing(TO_EXCHANGE);
+    ShmRing in = channel.GetRing(FROM_EXCHANGE);
+    Result result;
+    for (unsigned long i = 0; i < WARM_UP + ROUND_TRIPS; ++i)
+    {
+        const auto start = Clock::now();
+        unsigned char* data;
+        while ((data = out.Prepare(frame.size())) == nullptr)
+        {
+            sched_yield();
+        }
+        std::memcpy(data, frame.data(), frame.size());
+        out.Commit(frame.size());
+        out.Publish();
+        const auto sent = Clock::now();
+        while (in.Consume([](unsigned char const*, std::size_t) {}) == 0)
+        {
+            sched_yield();
+        }
+        const auto end = Clock::now();
+        if (i >= WARM_UP)
+        {
+            result.mRoundTrips.push_back(microseconds(end - start));
+            result.mSends.push_back(microseconds(sent - start));
+        }
+    }
+
+    out.Close();
+    echo.join();
+    return result;
+}
+
+static Result pingPongTcp()
+{
+    boost::asio::io_context context;
+    tcp::acceptor acceptor{context, tcp::endpoint{boost::asio::ip::address_v4::loopback(), 0}};
+    tcp::socket client{context};
+    client.connect(acceptor.local_endpoint());
+    tcp::socket server = acceptor.accept();
+    client.set_option(tcp::no_delay(true));
+    server.set_option(tcp::no_delay(true));
+    auto frame = makeFrame();
+
+    std::thread echo([&server, size = frame.size()] {
+        std::array<unsigned char, 64> data;
+        boost::system::error_code error;
+        while (boost::asio::read(server, boost::asio::buffer(data.data(), size), error) == size)
+        {
+            boost::asio::write(server, boost::asio::buffer(data.data(), size));
+        }
+    });
+
+    Result result;
+    for (unsigned long i = 0; i < WARM_UP + ROUND_TRIPS; ++i)
+    {
+        const auto start = Clock::now();
+        boost::asio::write(client, boost::asio::buffer(frame));
+        const auto sent = Clock::now();
+        boost::asio::read(client, boost::asio::buffer(frame));
+        const auto end = Clock::now();
+        if (i >= WARM_UP)
+        {
+            result.mRoundTrips.push_back(microseconds(end - start));
+            result.mSends.push_back(microseconds(sent - start));
+        }
+    }
+
+    client.shutdown(tcp::socket::shutdown_both);
+    echo.join();
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    const std::string name = (argc > 1) ? argv[1]
+                                        : (std::filesystem::temp_directory_path() / "shm_pingpong.dat").string();
+    try
+    {
+        auto shm = pingPongShm(name);
+        std::filesystem::remove(name);
+        auto tcp = pingPongTcp();
+        std::printf("%lu round trips of a %zu-byte insert frame\n", ROUND_TRIPS, makeFrame().size());
+        report("shm", shm);
+        report("tcp", tcp);
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
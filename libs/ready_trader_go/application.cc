@@ -22,6 +22,7 @@
 #include <string>
 
 #define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/asio/executor_work_guard.hpp>
 #include <boost/log/attributes/clock.hpp>
 #include <boost/log/core.hpp>
 #include <boost/log/expressions.hpp>
@@ -86,6 +87,14 @@ void Application::LoadConfig(const std::string& filename)
         throw ReadyTraderGoError("failed while reading configuration file: '" + filename + "': " + err.message());
     }
 
+    mThreadSettings.readFromPropertyTree(tree, "Threading");
+
+    const auto runMode = tree.get<std::string>("Threading.RunMode", "run");
+    if (runMode != "run" && runMode != "busy_poll")
+    {
+        throw ReadyTraderGoError("configured run mode '" + runMode + "' is not one of 'run' or 'busy_poll'");
+    }
+    mIsBusyPolling = (runMode == "busy_poll");
     OnConfigLoaded(tree);
 }
 
@@ -113,8 +122,44 @@ void Application::Run(int argc, char* argv[])
 #endif
     mSignals.async_wait([this](const boost::system::error_code& ec, int s) { SignalHandler(ec, s); });
 
+    // The io_context runs on this thread, so set it up before anything
+    // else is created (memory locking, for one, covers later mappings).
+    configureCurrentThread(mThreadSettings, mName);
+
     OnReadyToRun();
-    mContext.run();
+    if (mIsBusyPolling)
+    {
+        BusyPoll();
+    }
+    else
+    {
+        mContext.run();
+    }
+}
+
+void Application::BusyPoll()
+{
+    RLOG(LG_APP, LogLevel::LL_INFO) << "busy polling with " << mPollers.size() << " pollers";
+
+    // Without outstanding work, poll() would mark the context as stopped
+    // whenever the handler queue happened to be empty.
+    auto work = boost::asio::make_work_guard(mContext);
+
+    unsigned long long passes = 0;
+    unsigned long long polled = 0;
+    unsigned long long handlers = 0;
+    while (!mContext.stopped())
+    {
+        for (auto& poller : mPollers)
+        {
+            polled += poller();
+        }
+        handlers += mContext.poll();
+        ++passes;
+    }
+
+    RLOG(LG_APP, LogLevel::LL_INFO) << "busy polling finished: passes=" << passes << " polled=" << polled
+                                    << " handlers=" << handlers;
 }
 
 void Application::SetUpLogging()
@@ -22,6 +22,7 @@
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/signal_set.hpp>
@@ -33,6 +34,8 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/system/error_code.hpp>
 
+#include "threading.h"
+
 namespace ReadyTraderGo {
 
 constexpr std::size_t LOG_QUEUE_SIZE = 1024;
@@ -53,6 +56,15 @@ public:
 
     void Run(int argc, char* argv[]);
 
+    // True if "Threading.RunMode" is "busy_poll", in which case the run
+    // loop never blocks: each pass calls every poller and then runs
+    // whatever handlers are ready.
+    bool IsBusyPolling() const { return mIsBusyPolling; }
+
+    // Add a function to be called on each pass of the busy-poll run loop.
+    // It should return the number of items it processed.
+    void AddPoller(std::function<std::size_t()> poller) { mPollers.push_back(std::move(poller)); }
+
     std::function<void(const boost::property_tree::ptree&)> ConfigLoaded;
     std::function<void()> ReadyToRun;
 
@@ -60,6 +72,7 @@ private:
     void OnConfigLoaded(const boost::property_tree::ptree& tree) const;
     void OnReadyToRun() const;
 
+    void BusyPoll();
     void LoadConfig(const std::string& filename);
     void SetUpLogging();
     void SignalHandler(const boost::system::error_code& error, int signal);
@@ -68,6 +81,9 @@ private:
     boost::asio::io_context mContext;
     std::string mName;
     boost::asio::signal_set mSignals;
+    ThreadSettings mThreadSettings;
+    bool mIsBusyPolling = false;
+    std::vector<std::function<std::size_t()>> mPollers;
 
     using sink_t = boost::log::sinks::asynchronous_sink<
         boost::log::sinks::text_ostream_backend,
@@ -15,7 +15,9 @@
 //     You should have received a copy of the GNU Affero General Public
 //     License along with Ready Trader Go.  If not, see
 //     <https://www.gnu.org/licenses/>.
+#include <chrono>
 #include <memory>
+#include <string>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -23,9 +25,23 @@
 #include "connectivity.h"
 #include "config.h"
 #include "error.h"
+#include "shmconnection.h"
+#include "udpsubscription.h"
+#include "uringconnection.h"
 
 namespace ReadyTraderGo {
 
+static PollPolicy toPollPolicy(const std::string& name)
+{
+    if (name == "spin")
+        return PollPolicy::SPIN;
+    if (name == "yield")
+        return PollPolicy::YIELD;
+    if (name == "sleep")
+        return PollPolicy::SLEEP;
+    throw ReadyTraderGoError("configured poll policy '" + name + "' is not one of 'spin', 'yield' or 'sleep'");
+}
+
 void AutoTraderAppHandler::ConfigLoadedHandler(const boost::property_tree::ptree& tree)
 {
     Config config;
@@ -37,21 +53,139 @@ void AutoTraderAppHandler::ConfigLoadedHandler(const boost::property_tree::ptree
     if (config.mSecret.size() > MessageFieldSize::STRING)
         throw ReadyTraderGoError("configured secret is too long");
 
-    mExecConnectionFactory = std::make_unique<ConnectionFactory>(mContext,
-                                                                 config.mExecHost,
-                                                                 config.mExecPort);
-    mInfoSubscriptionFactory = std::make_unique<SubscriptionFactory>(mContext,
-                                                                     config.mInfoType,
-                                                                     config.mInfoName);
+    if (config.mInfoMaxBatch == 0)
+        throw ReadyTraderGoError("configured information max batch must be at least one");
+
+    if (!(config.mSpeed > 0.0))
+        throw ReadyTraderGoError("configured engine speed must be positive");
+
+    if (config.mLimits.mMessageFrequencyMargin < std::chrono::steady_clock::duration::zero())
+        throw ReadyTraderGoError("configured message frequency margin must not be negative");
+
+    if (config.mLimits.mMessageFrequencyLimit == 0)
+        throw ReadyTraderGoError("configured message frequency limit must be at least one");
+
+    // With a pipeline, the connection and subscription belong to the
+    // gateway and feed threads, and the feed thread polls the subscription.
+    boost::asio::io_context* execContext = &mContext;
+    boost::asio::io_context* infoContext = &mContext;
+    if (config.mPipeline)
+    {
+        PipelineSettings pipelineSettings;
+        pipelineSettings.mQueueCapacity = config.mPipelineQueueCapacity;
+        pipelineSettings.mYieldWhenIdle = config.mPipelineYield;
+        pipelineSettings.mFeedThread = config.mFeedThread;
+        pipelineSettings.mGatewayThread = config.mGatewayThread;
+        mPipeline = std::make_unique<Pipeline>(pipelineSettings);
+        execContext = &mPipeline->GetGatewayContext();
+        infoContext = &mPipeline->GetFeedContext();
+    }
+
+    SubscriptionSettings infoSettings;
+    infoSettings.mRingSize = config.mInfoRingSize;
+    infoSettings.mPollPolicy = toPollPolicy(config.mInfoPollPolicy);
+    infoSettings.mSpinCount = config.mInfoSpinCount;
+    infoSettings.mSleepInterval = std::chrono::microseconds(config.mInfoSleepInterval);
+    infoSettings.mMaxBatch = config.mInfoMaxBatch;
+    infoSettings.mIsPolledExternally = mApplication.IsBusyPolling() || mPipeline != nullptr;
+    infoSettings.mPrefault = config.mInfoPrefault;
+    infoSettings.mLock = config.mInfoLock;
+    infoSettings.mHugePages = config.mInfoHugePages;
+    infoSettings.mReceiveBufferSize = config.mInfoReceiveBufferSize;
+    infoSettings.mInterface = config.mInfoInterface;
+    infoSettings.mTimestamps = config.mInfoTimestamps;
+
+    if (config.mExecTransport == "io_uring")
+    {
+        UringSettings uringSettings;
+        uringSettings.mEntries = config.mExecRingEntries;
+        uringSettings.mSqPoll = config.mExecSqPoll;
+        uringSettings.mSqPollIdle = config.mExecSqPollIdle;
+        uringSettings.mReceiveBufferCount = config.mExecReceiveBufferCount;
+        uringSettings.mReceiveBufferSize = config.mExecReceiveBufferSize;
+        mExecConnectionFactory = std::make_unique<UringConnectionFactory>(*execContext,
+                                                                          config.mExecHost,
+                                                                          config.mExecPort,
+                                                                          uringSettings);
+    }
+    else if (config.mExecTransport == "shm")
+    {
+        mExecConnectionFactory = std::make_unique<ShmConnectionFactory>(*execContext, config.mExecName);
+    }
+    else if (config.mExecTransport == "tcp")
+    {
+        mExecConnectionFactory = std::make_unique<ConnectionFactory>(*execContext,
+                                                                     config.mExecHost,
+                                                                     config.mExecPort,
+                                                                     config.mExecBusyPoll);
+    }
+    else
+    {
+        throw ReadyTraderGoError("configured execution transport '" + config.mExecTransport
+                                 + "' is not one of 'tcp', 'io_uring' or 'shm'");
+    }
+
+    if (config.mInfoType == "udp")
+    {
+        mInfoSubscriptionFactory = std::make_unique<UdpSubscriptionFactory>(*infoContext,
+                                                                            config.mInfoName,
+                                                                            infoSettings);
+    }
+    else if (config.mInfoType == "mmap" || config.mInfoType == "shm")
+    {
+        mInfoSubscriptionFactory = std::make_unique<SubscriptionFactory>(*infoContext,
+                                                                         config.mInfoType,
+                                                                         config.mInfoName,
+                                                                         infoSettings);
+    }
+    else
+    {
+        throw ReadyTraderGoError("configured information type '" + config.mInfoType
+                                 + "' is not one of 'mmap', 'shm' or 'udp'");
+    }
+
+    mOrderCommands = std::make_unique<OrderCommandQueue>(mContext,
+                                                         config.mExecCommandQueueCapacity,
+                                                         mApplication.IsBusyPolling());
 
     mAutoTrader.SetLoginDetails(config.mTeamName, config.mSecret);
+    mAutoTrader.SetRiskLimits(config.mLimits);
 }
 
 void AutoTraderAppHandler::ReadyToRunHandler()
 {
+    if (mApplication.IsBusyPolling())
+    {
+        mApplication.AddPoller([t = &mAutoTrader] { return t->ProcessOrderCommands(); });
+    }
+    mAutoTrader.SetOrderCommandQueue(std::move(mOrderCommands));
+
+    if (mPipeline)
+    {
+        mPipeline->Start(mExecConnectionFactory->Create(), mInfoSubscriptionFactory->Create());
+
+        const bool isBusyPolling = mApplication.IsBusyPolling();
+        auto connection = mPipeline->CreateConnection(mContext, isBusyPolling);
+        auto subscription = mPipeline->CreateSubscription(mContext, isBusyPolling);
+        if (isBusyPolling)
+        {
+            mApplication.AddPoller([c = connection.get()] { return c->Poll(); });
+            mApplication.AddPoller([s = subscription.get()] { return s->Poll(); });
+        }
+        mAutoTrader.SetExecutionConnection(std::move(connection));
+        mAutoTrader.SetInformationSubscription(std::move(subscription));
+        return;
+    }
+
     auto connection = mExecConnectionFactory->Create();
     mAutoTrader.SetExecutionConnection(std::move(connection));
     auto subscription = mInfoSubscriptionFactory->Create();
+    if (mApplication.IsBusyPolling())
+    {
+        // The auto-trader owns the subscription for as long as the run
+        // loop can call this.
+        mApplication.AddPoller([s = subscription.get()] { return s->Poll(); });
+    }
     mAutoTrader.SetInformationSubscription(std::move(subscription));
 }
 
@@ -25,13 +25,14 @@
 #include "application.h"
 #include "baseautotrader.h"
 #include "connectivity.h"
+#include "pipeline.h"
 
 namespace ReadyTraderGo {
 
 class AutoTraderAppHandler
 {
 public:
-    explicit AutoTraderAppHandler(Application& application, BaseAutoTrader& autoTrader)
+    explicit AutoTraderAppHandler(Application& application, IAutoTrader& autoTrader)
         : mApplication(application), mAutoTrader(autoTrader), mContext(mApplication.GetContext())
     {
         mApplication.ConfigLoaded = [this](auto& tree) { ConfigLoadedHandler(tree); };
@@ -43,11 +44,15 @@ private:
     void ReadyToRunHandler();
 
     Application& mApplication;
-    BaseAutoTrader& mAutoTrader;
+    IAutoTrader& mAutoTrader;
     boost::asio::io_context& mContext;
 
-    std::unique_ptr<ConnectionFactory> mExecConnectionFactory;
-    std::unique_ptr<SubscriptionFactory> mInfoSubscriptionFactory;
+    // Only set when the feed and gateway run on threads of their own.
+    std::unique_ptr<Pipeline> mPipeline;
+
+    std::unique_ptr<IConnectionFactory> mExecConnectionFactory;
+    std::unique_ptr<ISubscriptionFactory> mInfoSubscriptionFactory;
+    std::unique_ptr<OrderCommandQueue> mOrderCommands;
 };
 
 }
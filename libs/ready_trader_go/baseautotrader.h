@@ -18,6 +18,7 @@
 #ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_BASEAUTOTRADER_H
 #define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_BASEAUTOTRADER_H
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <memory>
@@ -28,46 +29,197 @@
 #include <boost/asio/io_context.hpp>
 
 #include "connectivitytypes.h"
+#include "error.h"
+#include "logging.h"
+#include "ordercommands.h"
+#include "orderscheduler.h"
 #include "protocol.h"
+#include "riskengine.h"
 #include "types.h"
 
+RTG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_BAT, "BASE")
+
 namespace ReadyTraderGo {
 
-class BaseAutoTrader
+// What the application needs to set an auto-trader up and run it,
+// whichever way the auto-trader dispatches messages.
+struct IAutoTrader
+{
+    virtual ~IAutoTrader() = default;
+    virtual void SetExecutionConnection(std::unique_ptr<IConnection>&& connection) = 0;
+    virtual void SetInformationSubscription(std::shared_ptr<ISubscription>&& subscription) = 0;
+    virtual void SetLoginDetails(std::string teamName, std::string secret) = 0;
+    virtual void SetRiskLimits(const RiskLimits& limits) = 0;
+    virtual void SetOrderCommandQueue(std::unique_ptr<OrderCommandQueue>&& queue) = 0;
+
+    // Send every submitted order command, in one batch, and return the count.
+    virtual std::size_t ProcessOrderCommands() = 0;
+};
+
+// An auto-trader whose handlers are bound at compile time.
+//
+// Derived hides whichever of the handlers below it is interested in. The
+// connection and subscription callbacks switch on the message type and
+// call Derived's handlers directly, so the only indirect call left per
+// message is the transport's callback itself, and the handlers can be
+// inlined into it. Likewise, submitted order commands are sent with
+// Derived's Send functions. Derived's handlers must be accessible from
+// this class, e.g. by declaring it a friend.
+//
+// Every order is checked against the exchange's limits before it is
+// sent; a Send function returns false, without sending anything, if the
+// order would breach one. Orders may instead be scheduled, in which case
+// they wait until the message frequency limit allows them (see
+// OrderScheduler).
+template<typename Derived>
+class BaseAutoTraderT : public IAutoTrader
 {
 public:
-    explicit BaseAutoTrader(boost::asio::io_context& context) : mContext(context) {};
+    explicit BaseAutoTraderT(boost::asio::io_context& context) : mContext(context), mScheduler(context)
+    {
+        mScheduler.BudgetAvailable = [this] { ReleaseScheduledOrders(); };
+    };
 
-    virtual void SendAmendOrder(unsigned long clientOrderId, unsigned long volume);
-    virtual void SendCancelOrder(unsigned long clientOrderId);
-    virtual void SendHedgeOrder(unsigned long clientOrderId,
-                                Side side,
-                                unsigned long price,
-                                unsigned long volume);
-    virtual void SendInsertOrder(unsigned long clientOrderId,
-                                 Side side,
-                                 unsigned long price,
-                                 unsigned long volume,
-                                 Lifespan lifespan);
+    // Messages sent between BeginBatch and EndBatch are written together.
+    void BeginBatch() { mExecutionConnection->BeginBatch(); }
+    void EndBatch() { mExecutionConnection->EndBatch(); }
+
+    bool SendAmendOrder(unsigned long clientOrderId, unsigned long volume);
+    bool SendCancelOrder(unsigned long clientOrderId);
+    bool SendHedgeOrder(unsigned long clientOrderId, Side side, unsigned long price, unsigned long volume);
+    bool SendInsertOrder(unsigned long clientOrderId,
+                         Side side,
+                         unsigned long price,
+                         unsigned long volume,
+                         Lifespan lifespan);
+
+    void SetExecutionConnection(std::unique_ptr<IConnection>&& connection) override;
+    void SetInformationSubscription(std::shared_ptr<ISubscription>&& subscription) override;
+    void SetLoginDetails(std::string teamName, std::string secret) override;
+    void SetRiskLimits(const RiskLimits& limits) override { mRisk.SetLimits(limits); }
+    void SetOrderCommandQueue(std::unique_ptr<OrderCommandQueue>&& queue) override;
 
-    virtual void SetExecutionConnection(std::unique_ptr<IConnection>&& connection);
-    virtual void SetInformationSubscription(std::shared_ptr<ISubscription>&& subscription);
-    virtual void SetLoginDetails(std::string teamName, std::string secret);
+    // These may be called from any thread. Each queues the operation for
+    // the io_context thread, which sends it with the corresponding Send
+    // function above, and returns false if the queue is full (or there is
+    // no queue). An insert or hedge is given the next client order id when
+    // it is sent and is reported, by key, to SubmittedOrderSentHandler.
+    bool SubmitAmendOrder(unsigned long clientOrderId, unsigned long volume);
+    bool SubmitCancelOrder(unsigned long clientOrderId);
+    bool SubmitHedgeOrder(unsigned long key, Side side, unsigned long price, unsigned long volume);
+    bool SubmitInsertOrder(unsigned long key,
+                           Side side,
+                           unsigned long price,
+                           unsigned long volume,
+                           Lifespan lifespan);
+
+    std::size_t ProcessOrderCommands() override;
+
+    // Queue an order to be sent as soon as the message frequency limit
+    // allows, sending it now if it already does, and return false if the
+    // scheduler is full. Cancels, amends and hedges go before inserts. An
+    // insert or hedge is given the next client order id when it is sent
+    // and is reported, by key, to ScheduledOrderSentHandler; an insert
+    // replaces any insert with the same key that is still waiting. An
+    // order refused for want of message budget waits for the next budget;
+    // one refused for any other reason is dropped, and an insert or hedge
+    // is then reported with a zero id. ScheduledOrderSentHandler must not
+    // schedule orders itself.
+    bool ScheduleAmendOrder(unsigned long clientOrderId, unsigned long volume);
+    bool ScheduleCancelOrder(unsigned long clientOrderId);
+    bool ScheduleHedgeOrder(unsigned long key, Side side, unsigned long price, unsigned long volume);
+    bool ScheduleInsertOrder(unsigned long key,
+                             Side side,
+                             unsigned long price,
+                             unsigned long volume,
+                             Lifespan lifespan);
+    bool UnscheduleInsertOrder(unsigned long key) { return mScheduler.Unschedule(key); }
+    bool HasScheduledOrders() const { return !mScheduler.IsEmpty(); }
+
+    // Send as many scheduled orders as the message frequency limit allows,
+    // in one batch, and return the count.
+    std::size_t ReleaseScheduledOrders();
+
+    // The id after the highest sent (or refused) so far. Auto-traders that
+    // schedule orders should take the ids of orders they send directly from
+    // here.
+    unsigned long NextClientOrderId() const { return mLastClientOrderId + 1; }
+
+    // Every order sent, as last reported by the exchange. The exchange's
+    // reports are applied before the handlers are called.
+    const OrderManager& GetOrders() const { return mRisk.GetOrders(); }
 
 protected:
     boost::asio::io_context& mContext;
     std::unique_ptr<IConnection> mExecutionConnection = nullptr;
     std::shared_ptr<ISubscription> mInformationSubscription = nullptr;
+    std::unique_ptr<OrderCommandQueue> mOrderCommands = nullptr;
 
     std::string mTeamName;
     std::string mSecret;
 
+    // Our orders and positions, as far as the exchange's limits go.
+    RiskEngine mRisk;
+    OrderScheduler mScheduler;
+    unsigned long mLastClientOrderId = 0;
+    RiskCheck mLastRefusal = RiskCheck::PASSED; // why the last order was refused
+
+    // Pre-encoded order messages; only the changing fields are written per send.
+    MessageTemplate<AmendMessage> mAmendTemplate;
+    MessageTemplate<CancelMessage> mCancelTemplate;
+    MessageTemplate<HedgeMessage> mHedgeTemplate;
+    MessageTemplate<InsertMessage> mInsertTemplate;
+
+    Derived& GetDerived() { return static_cast<Derived&>(*this); }
+
+    void MessageHandler(unsigned char messageType, unsigned char const* data, std::size_t size);
+    void InformationMessageHandler(unsigned char messageType, unsigned char const* data, std::size_t size);
+    bool RefuseOrder(const char* operation, unsigned long clientOrderId, RiskCheck check);
+    bool SendScheduledOrder(const ScheduledOrder& order);
+
+    // The default handlers, for Derived to hide.
+    void DisconnectHandler() { mContext.stop(); }
+    void ErrorMessageHandler(unsigned long clientOrderId, const std::string& errorMessage) {}
+    void HedgeFilledMessageHandler(unsigned long clientOrderId, unsigned long price, unsigned long volume) {}
+    void OrderBookMessageHandler(const OrderBookView& book) {}
+    void OrderFilledMessageHandler(unsigned long clientOrderId, unsigned long price, unsigned long volume) {}
+    void OrderStatusMessageHandler(unsigned long clientOrderId,
+                                   unsigned long fillVolume,
+                                   unsigned long remainingVolume,
+                                   signed long fees) {}
+    void TradeTicksMessageHandler(const TradeTicksView& ticks) {}
+    void ScheduledOrderSentHandler(unsigned long key, const OrderCommand& command) {}
+    void SubmittedOrderSentHandler(unsigned long key, const OrderCommand& command) {}
+    void InformationOverrunHandler(std::size_t framesSkipped) {}
+    void SequenceGapHandler(unsigned char messageType,
+                            Instrument instrument,
+                            unsigned long expectedSequenceNumber,
+                            unsigned long receivedSequenceNumber) {}
+};
+
+// The auto-trader with virtual handlers: the adapter between
+// BaseAutoTraderT's static dispatch and handlers overridden at run time.
+class BaseAutoTrader : public BaseAutoTraderT<BaseAutoTrader>
+{
+public:
+    using BaseAutoTraderT::BaseAutoTraderT;
+
+    virtual bool SendAmendOrder(unsigned long clientOrderId, unsigned long volume);
+    virtual bool SendCancelOrder(unsigned long clientOrderId);
+    virtual bool SendHedgeOrder(unsigned long clientOrderId,
+                                Side side,
+                                unsigned long price,
+                                unsigned long volume);
+    virtual bool SendInsertOrder(unsigned long clientOrderId,
+                                 Side side,
+                                 unsigned long price,
+                                 unsigned long volume,
+                                 Lifespan lifespan);
+
+protected:
+    friend class BaseAutoTraderT<BaseAutoTrader>;
+
     virtual void DisconnectHandler();
-    virtual void MessageHandler(IConnection*, unsigned char, unsigned char const*, std::size_t);
-    virtual void MessageHandler(ISubscription* subscription,
-                                unsigned char messageType,
-                                unsigned char const* data,
-                                std::size_t size);
 
     // Message callbacks
     virtual void ErrorMessageHandler(unsigned long clientOrderId,
@@ -75,6 +227,11 @@ protected:
     virtual void HedgeFilledMessageHandler(unsigned long clientOrderId,
                                            unsigned long price,
                                            unsigned long volume) {};
+    // By default the view callbacks decode every level and call the
+    // array-based callbacks below. Override the view callbacks instead to
+    // decode only the fields that are actually used.
+    virtual void OrderBookMessageHandler(const OrderBookView& book);
+    virtual void TradeTicksMessageHandler(const TradeTicksView& ticks);
     virtual void OrderBookMessageHandler(Instrument instrument,
                                          unsigned long sequenceNumber,
                                          const std::array<unsigned long, TOP_LEVEL_COUNT>& askPrices,
@@ -94,66 +251,442 @@ protected:
                                           const std::array<unsigned long, TOP_LEVEL_COUNT>& askVolumes,
                                           const std::array<unsigned long, TOP_LEVEL_COUNT>& bidPrices,
                                           const std::array<unsigned long, TOP_LEVEL_COUNT>& bidVolumes) {};
+
+    // Called when a scheduled insert or hedge is sent, with the client
+    // order id it was given, or with a zero id if it was refused.
+    virtual void ScheduledOrderSentHandler(unsigned long key, const OrderCommand& command) {};
+
+    // Likewise for a submitted insert or hedge.
+    virtual void SubmittedOrderSentHandler(unsigned long key, const OrderCommand& command) {};
+
+    // Information feed callbacks
+    virtual void InformationOverrunHandler(std::size_t framesSkipped) {};
+    virtual void SequenceGapHandler(unsigned char messageType,
+                                    Instrument instrument,
+                                    unsigned long expectedSequenceNumber,
+                                    unsigned long receivedSequenceNumber) {};
 };
 
-inline void BaseAutoTrader::DisconnectHandler()
+template<typename Derived>
+void BaseAutoTraderT<Derived>::SetExecutionConnection(std::unique_ptr<IConnection>&& connection)
 {
-    mContext.stop();
+    mExecutionConnection = std::move(connection);
+    mExecutionConnection->SetName("Exec");
+    mExecutionConnection->Disconnected = [this] { GetDerived().DisconnectHandler(); };
+    mExecutionConnection->MessageReceived = [this](IConnection*,
+                                                   unsigned char t,
+                                                   unsigned char const* d,
+                                                   std::size_t s) { MessageHandler(t, d, s); };
+
+    RLOG(LG_BAT, LogLevel::LL_INFO) << "logging in with teamname='" << mTeamName
+                                    << "' and secret='" << mSecret << '\'';
+    mExecutionConnection->SendMessage(LoginMessage{mTeamName, mSecret});
+
+    mExecutionConnection->AsyncRead();
 }
 
-inline void BaseAutoTrader::SetInformationSubscription(std::shared_ptr<ISubscription>&& subscription)
+template<typename Derived>
+void BaseAutoTraderT<Derived>::SetInformationSubscription(std::shared_ptr<ISubscription>&& subscription)
 {
     mInformationSubscription = std::move(subscription);
     mInformationSubscription->SetName("Info");
-    mInformationSubscription->MessageReceived = [this](ISubscription* s,
+    mInformationSubscription->Disconnected = [this](ISubscription*) { GetDerived().DisconnectHandler(); };
+    mInformationSubscription->MessageReceived = [this](ISubscription*,
                                                        unsigned char t,
                                                        unsigned char const* d,
-                                                       std::size_t z) { MessageHandler(s, t, d, z); };
+                                                       std::size_t z) { InformationMessageHandler(t, d, z); };
+    mInformationSubscription->Overrun = [this](ISubscription*, std::size_t n) {
+        GetDerived().InformationOverrunHandler(n);
+    };
+    mInformationSubscription->SequenceGap = [this](ISubscription*,
+                                                   unsigned char t,
+                                                   unsigned char i,
+                                                   unsigned long e,
+                                                   unsigned long r) {
+        GetDerived().SequenceGapHandler(t, Instrument(i), e, r);
+    };
     mInformationSubscription->AsyncReceive();
 }
 
-inline void BaseAutoTrader::SendAmendOrder(unsigned long clientOrderId, unsigned long volume)
+template<typename Derived>
+void BaseAutoTraderT<Derived>::SetLoginDetails(std::string teamName, std::string secret)
+{
+    mTeamName = std::move(teamName);
+    mSecret = std::move(secret);
+}
+
+template<typename Derived>
+void BaseAutoTraderT<Derived>::SetOrderCommandQueue(std::unique_ptr<OrderCommandQueue>&& queue)
+{
+    mOrderCommands = std::move(queue);
+    mOrderCommands->CommandsReady = [this] { ProcessOrderCommands(); };
+    mOrderCommands->AsyncWait();
+}
+
+template<typename Derived>
+inline void BaseAutoTraderT<Derived>::MessageHandler(unsigned char messageType,
+                                                     unsigned char const* data,
+                                                     std::size_t size)
+{
+    switch (messageType)
+    {
+    case MessageType::ERROR_MESSAGE:
+    {
+        auto err = makeMessage<ErrorMessage>(data, size);
+        mRisk.OnError(err.mClientOrderId);
+        GetDerived().ErrorMessageHandler(err.mClientOrderId, err.mMessage);
+        break;
+    }
+    case MessageType::HEDGE_FILLED:
+    {
+        auto filled = makeMessage<HedgeFilledMessage>(data, size);
+        mRisk.OnHedgeFilled(filled.mClientOrderId, filled.mPrice, filled.mVolume);
+        GetDerived().HedgeFilledMessageHandler(filled.mClientOrderId, filled.mPrice, filled.mVolume);
+        break;
+    }
+    case MessageType::ORDER_FILLED:
+    {
+        auto filled = makeMessage<OrderFilledMessage>(data, size);
+        mRisk.OnOrderFilled(filled.mClientOrderId, filled.mPrice, filled.mVolume);
+        GetDerived().OrderFilledMessageHandler(filled.mClientOrderId, filled.mPrice, filled.mVolume);
+        break;
+    }
+    case MessageType::ORDER_STATUS:
+    {
+        auto status = makeMessage<OrderStatusMessage>(data, size);
+        mRisk.OnOrderStatus(status.mClientOrderId, status.mFillVolume, status.mRemainingVolume, status.mFees);
+        GetDerived().OrderStatusMessageHandler(status.mClientOrderId, status.mFillVolume,
+                                               status.mRemainingVolume, status.mFees);
+        break;
+    }
+    default:
+    {
+        RLOG(LG_BAT, LogLevel::LL_ERROR) << "received execution message with unexpected type: "
+                                         << static_cast<int>(messageType);
+        throw ReadyTraderGoError("received execution message with unexpected type");
+    }
+    }
+}
+
+template<typename Derived>
+inline void BaseAutoTraderT<Derived>::InformationMessageHandler(unsigned char messageType,
+                                                                unsigned char const* data,
+                                                                std::size_t size)
+{
+    switch (messageType)
+    {
+    case MessageType::ORDER_BOOK_UPDATE:
+        GetDerived().OrderBookMessageHandler(OrderBookView{data, size});
+        break;
+    case MessageType::TRADE_TICKS:
+        GetDerived().TradeTicksMessageHandler(TradeTicksView{data, size});
+        break;
+    default:
+        RLOG(LG_BAT, LogLevel::LL_ERROR) << "received information message with unexpected type: "
+                                         << static_cast<int>(messageType);
+        throw ReadyTraderGoError("received information message with unexpected type");
+    }
+}
+
+template<typename Derived>
+std::size_t BaseAutoTraderT<Derived>::ProcessOrderCommands()
+{
+    if (!mOrderCommands || mOrderCommands->IsEmpty())
+    {
+        return 0;
+    }
+
+    SendBatch<IConnection> batch(*mExecutionConnection);
+    return mOrderCommands->Drain([this](const OrderCommand& submitted) {
+        OrderCommand command = submitted;
+        switch (command.mType)
+        {
+        case OrderCommandType::INSERT:
+            command.mClientOrderId = NextClientOrderId();
+            if (!GetDerived().SendInsertOrder(command.mClientOrderId, command.mSide, command.mPrice,
+                                              command.mVolume, command.mLifespan))
+            {
+                command.mClientOrderId = 0;
+            }
+            GetDerived().SubmittedOrderSentHandler(submitted.mClientOrderId, command);
+            break;
+        case OrderCommandType::AMEND:
+            GetDerived().SendAmendOrder(command.mClientOrderId, command.mVolume);
+            break;
+        case OrderCommandType::CANCEL:
+            GetDerived().SendCancelOrder(command.mClientOrderId);
+            break;
+        case OrderCommandType::HEDGE:
+            command.mClientOrderId = NextClientOrderId();
+            if (!GetDerived().SendHedgeOrder(command.mClientOrderId, command.mSide, command.mPrice,
+                                             command.mVolume))
+            {
+                command.mClientOrderId = 0;
+            }
+            GetDerived().SubmittedOrderSentHandler(submitted.mClientOrderId, command);
+            break;
+        }
+    });
+}
+
+template<typename Derived>
+bool BaseAutoTraderT<Derived>::RefuseOrder(const char* operation, unsigned long clientOrderId, RiskCheck check)
+{
+    RLOG(LG_BAT, LogLevel::LL_WARNING) << "refused " << operation << " for order " << clientOrderId
+                                       << ": " << check;
+    mLastRefusal = check;
+    return false;
+}
+
+template<typename Derived>
+inline bool BaseAutoTraderT<Derived>::SendAmendOrder(unsigned long clientOrderId, unsigned long volume)
+{
+    const RiskCheck check = mRisk.TryAmend(clientOrderId, volume, RiskEngine::Clock::now());
+    if (check != RiskCheck::PASSED)
+    {
+        return RefuseOrder("amend", clientOrderId, check);
+    }
+    mAmendTemplate.template Set<&AmendMessage::mClientOrderId>(clientOrderId);
+    mAmendTemplate.template Set<&AmendMessage::mNewVolume>(volume);
+    mExecutionConnection->SendMessage(mAmendTemplate);
+    return true;
+}
+
+template<typename Derived>
+inline bool BaseAutoTraderT<Derived>::SendCancelOrder(unsigned long clientOrderId)
+{
+    const RiskCheck check = mRisk.TryCancel(clientOrderId, RiskEngine::Clock::now());
+    if (check != RiskCheck::PASSED)
+    {
+        return RefuseOrder("cancel", clientOrderId, check);
+    }
+    mCancelTemplate.template Set<&CancelMessage::mClientOrderId>(clientOrderId);
+    mExecutionConnection->SendMessage(mCancelTemplate);
+    return true;
+}
+
+template<typename Derived>
+inline bool BaseAutoTraderT<Derived>::SendHedgeOrder(unsigned long clientOrderId,
+                                                     Side side,
+                                                     unsigned long price,
+                                                     unsigned long volume)
 {
-    mExecutionConnection->SendMessage(MessageType::AMEND_ORDER,
-                                      AmendMessage{clientOrderId, volume});
+    // A refused id is used up too, so that the next attempt is given a new one.
+    mLastClientOrderId = std::max(mLastClientOrderId, clientOrderId);
+    const RiskCheck check = mRisk.TryHedge(clientOrderId, side, price, volume, RiskEngine::Clock::now());
+    if (check != RiskCheck::PASSED)
+    {
+        return RefuseOrder("hedge", clientOrderId, check);
+    }
+    mHedgeTemplate.template Set<&HedgeMessage::mClientOrderId>(clientOrderId);
+    mHedgeTemplate.template Set<&HedgeMessage::mSide>(side);
+    mHedgeTemplate.template Set<&HedgeMessage::mPrice>(price);
+    mHedgeTemplate.template Set<&HedgeMessage::mVolume>(volume);
+    mExecutionConnection->SendMessage(mHedgeTemplate);
+    return true;
 }
 
-inline void BaseAutoTrader::SendCancelOrder(unsigned long clientOrderId)
+template<typename Derived>
+inline bool BaseAutoTraderT<Derived>::SendInsertOrder(unsigned long clientOrderId,
+                                                      Side side,
+                                                      unsigned long price,
+                                                      unsigned long volume,
+                                                      Lifespan lifespan)
 {
-    mExecutionConnection->SendMessage(MessageType::CANCEL_ORDER,
-                                      CancelMessage{clientOrderId});
+    // A refused id is used up too, so that the next attempt is given a new one.
+    mLastClientOrderId = std::max(mLastClientOrderId, clientOrderId);
+    const RiskCheck check = mRisk.TryInsert(clientOrderId, side, price, volume, lifespan,
+                                            RiskEngine::Clock::now());
+    if (check != RiskCheck::PASSED)
+    {
+        return RefuseOrder("insert", clientOrderId, check);
+    }
+    mInsertTemplate.template Set<&InsertMessage::mClientOrderId>(clientOrderId);
+    mInsertTemplate.template Set<&InsertMessage::mSide>(side);
+    mInsertTemplate.template Set<&InsertMessage::mPrice>(price);
+    mInsertTemplate.template Set<&InsertMessage::mVolume>(volume);
+    mInsertTemplate.template Set<&InsertMessage::mLifespan>(lifespan);
+    mExecutionConnection->SendMessage(mInsertTemplate);
+    return true;
 }
 
-inline void BaseAutoTrader::SendHedgeOrder(unsigned long clientOrderId,
+template<typename Derived>
+inline bool BaseAutoTraderT<Derived>::SubmitAmendOrder(unsigned long clientOrderId, unsigned long volume)
+{
+    return mOrderCommands && mOrderCommands->Submit(
+        OrderCommand{OrderCommandType::AMEND, Side::SELL, Lifespan::FILL_AND_KILL, clientOrderId, 0, volume});
+}
+
+template<typename Derived>
+inline bool BaseAutoTraderT<Derived>::SubmitCancelOrder(unsigned long clientOrderId)
+{
+    return mOrderCommands && mOrderCommands->Submit(
+        OrderCommand{OrderCommandType::CANCEL, Side::SELL, Lifespan::FILL_AND_KILL, clientOrderId, 0, 0});
+}
+
+template<typename Derived>
+inline bool BaseAutoTraderT<Derived>::SubmitHedgeOrder(unsigned long key,
+                                                       Side side,
+                                                       unsigned long price,
+                                                       unsigned long volume)
+{
+    return mOrderCommands && mOrderCommands->Submit(
+        OrderCommand{OrderCommandType::HEDGE, side, Lifespan::FILL_AND_KILL, key, price, volume});
+}
+
+template<typename Derived>
+inline bool BaseAutoTraderT<Derived>::SubmitInsertOrder(unsigned long key,
+                                                        Side side,
+                                                        unsigned long price,
+                                                        unsigned long volume,
+                                                        Lifespan lifespan)
+{
+    return mOrderCommands && mOrderCommands->Submit(
+        OrderCommand{OrderCommandType::INSERT, side, lifespan, key, price, volume});
+}
+
+template<typename Derived>
+bool BaseAutoTraderT<Derived>::ScheduleAmendOrder(unsigned long clientOrderId, unsigned long volume)
+{
+    const bool isScheduled = mScheduler.ScheduleAmend(clientOrderId, volume);
+    ReleaseScheduledOrders();
+    return isScheduled;
+}
+
+template<typename Derived>
+bool BaseAutoTraderT<Derived>::ScheduleCancelOrder(unsigned long clientOrderId)
+{
+    const bool isScheduled = mScheduler.ScheduleCancel(clientOrderId);
+    ReleaseScheduledOrders();
+    return isScheduled;
+}
+
+template<typename Derived>
+bool BaseAutoTraderT<Derived>::ScheduleHedgeOrder(unsigned long key,
+                                                  Side side,
+                                                  unsigned long price,
+                                                  unsigned long volume)
+{
+    const bool isScheduled = mScheduler.ScheduleHedge(key, side, price, volume);
+    ReleaseScheduledOrders();
+    return isScheduled;
+}
+
+template<typename Derived>
+bool BaseAutoTraderT<Derived>::ScheduleInsertOrder(unsigned long key,
+                                                   Side side,
+                                                   unsigned long price,
+                                                   unsigned long volume,
+                                                   Lifespan lifespan)
+{
+    const bool isScheduled = mScheduler.ScheduleInsert(key, side, price, volume, lifespan);
+    ReleaseScheduledOrders();
+    return isScheduled;
+}
+
+template<typename Derived>
+std::size_t BaseAutoTraderT<Derived>::ReleaseScheduledOrders()
+{
+    if (mScheduler.IsEmpty())
+    {
+        return 0;
+    }
+
+    const FrequencyLimiter& frequency = mRisk.GetFrequencyLimiter();
+    const auto now = RiskEngine::Clock::now();
+    SendBatch<IConnection> batch(*mExecutionConnection);
+    const std::size_t count = mScheduler.Release([&] { return frequency.IsAvailable(now); },
+                                                 [this](const ScheduledOrder& order) {
+        if (SendScheduledOrder(order))
+        {
+            return;
+        }
+
+        // An order refused only for want of message budget waits for the
+        // next budget, unless something newer has replaced it by then.
+        // Anything else is refused for good and, if it is an insert or a
+        // hedge, reported with a zero id.
+        const bool isRequeued = mLastRefusal == RiskCheck::MESSAGE_FREQUENCY_LIMIT && mScheduler.Requeue(order);
+        const OrderCommandType type = order.mCommand.mType;
+        if (!isRequeued && (type == OrderCommandType::INSERT || type == OrderCommandType::HEDGE))
+        {
+            OrderCommand command = order.mCommand;
+            command.mClientOrderId = 0;
+            GetDerived().ScheduledOrderSentHandler(order.mKey, command);
+        }
+    });
+
+    if (!mScheduler.IsEmpty())
+    {
+        mScheduler.WakeAt(frequency.GetNextAvailableTime());
+    }
+    return count;
+}
+
+template<typename Derived>
+bool BaseAutoTraderT<Derived>::SendScheduledOrder(const ScheduledOrder& order)
+{
+    mLastRefusal = RiskCheck::PASSED;
+    OrderCommand command = order.mCommand;
+    switch (command.mType)
+    {
+    case OrderCommandType::INSERT:
+        command.mClientOrderId = NextClientOrderId();
+        if (!GetDerived().SendInsertOrder(command.mClientOrderId, command.mSide, command.mPrice,
+                                          command.mVolume, command.mLifespan))
+        {
+            return false;
+        }
+        GetDerived().ScheduledOrderSentHandler(order.mKey, command);
+        return true;
+    case OrderCommandType::AMEND:
+        return GetDerived().SendAmendOrder(command.mClientOrderId, command.mVolume);
+    case OrderCommandType::CANCEL:
+        return GetDerived().SendCancelOrder(command.mClientOrderId);
+    case OrderCommandType::HEDGE:
+        command.mClientOrderId = NextClientOrderId();
+        if (!GetDerived().SendHedgeOrder(command.mClientOrderId, command.mSide, command.mPrice, command.mVolume))
+        {
+            return false;
+        }
+        GetDerived().ScheduledOrderSentHandler(order.mKey, command);
+        return true;
+    }
+    return false;
+}
+
+extern template class BaseAutoTraderT<BaseAutoTrader>;
+
+inline void BaseAutoTrader::DisconnectHandler()
+{
+    BaseAutoTraderT::DisconnectHandler();
+}
+
+inline bool BaseAutoTrader::SendAmendOrder(unsigned long clientOrderId, unsigned long volume)
+{
+    return BaseAutoTraderT::SendAmendOrder(clientOrderId, volume);
+}
+
+inline bool BaseAutoTrader::SendCancelOrder(unsigned long clientOrderId)
+{
+    return BaseAutoTraderT::SendCancelOrder(clientOrderId);
+}
+
+inline bool BaseAutoTrader::SendHedgeOrder(unsigned long clientOrderId,
                                            Side side,
                                            unsigned long price,
                                            unsigned long volume)
 {
-    mExecutionConnection->SendMessage(MessageType::HEDGE_ORDER,
-                                      HedgeMessage{clientOrderId,
-                                                   side,
-                                                   price,
-                                                   volume});
+    return BaseAutoTraderT::SendHedgeOrder(clientOrderId, side, price, volume);
 }
 
-inline void BaseAutoTrader::SendInsertOrder(unsigned long clientOrderId,
+inline bool BaseAutoTrader::SendInsertOrder(unsigned long clientOrderId,
                                             Side side,
                                             unsigned long price,
                                             unsigned long volume,
                                             Lifespan lifespan)
 {
-    mExecutionConnection->SendMessage(MessageType::INSERT_ORDER,
-                                      InsertMessage{clientOrderId,
-                                                    side,
-                                                    price,
-                                                    volume,
-                                                    lifespan});
-}
-
-inline void BaseAutoTrader::SetLoginDetails(std::string teamName, std::string secret)
-{
-    mTeamName = std::move(teamName);
-    mSecret = std::move(secret);
+    return BaseAutoTraderT::SendInsertOrder(clientOrderId, side, price, volume, lifespan);
 }
 
 }
@@ -0,0 +1,233 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_BUFFERS_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_BUFFERS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+
+namespace ReadyTraderGo {
+
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+// Cache-line aligned storage that is allocated once and never resized.
+class AlignedStorage
+{
+public:
+    explicit AlignedStorage(std::size_t capacity)
+        : mData(static_cast<unsigned char*>(::operator new[](capacity, std::align_val_t{CACHE_LINE_SIZE}))),
+          mCapacity(capacity) {}
+
+    unsigned char* Get() const { return mData.get(); }
+    std::size_t GetCapacity() const { return mCapacity; }
+
+private:
+    struct Deleter
+    {
+        void operator()(unsigned char* p) const { ::operator delete[](p, std::align_val_t{CACHE_LINE_SIZE}); }
+    };
+
+    std::unique_ptr<unsigned char[], Deleter> mData;
+    std::size_t mCapacity;
+};
+
+// A preallocated buffer for a stream of length-prefixed messages.
+//
+// Data is received directly into the buffer and parsed in place; bytes
+// belonging to a message that has not yet fully arrived simply stay where
+// they are until the rest of the message is received. The read and write
+// positions return to the start of the buffer whenever everything received
+// has been consumed, which is the usual case, and the few bytes of a
+// partial message are only moved to the front when fewer than
+// minimumSpace bytes remain at the end of the buffer. As long as
+// minimumSpace is at least the largest possible message, a message can
+// therefore always be completed without reallocating.
+class ReceiveBuffer
+{
+public:
+    ReceiveBuffer(std::size_t capacity, std::size_t minimumSpace)
+        : mStorage(capacity), mMinimumSpace(minimumSpace) {}
+
+    // Return the space into which more data may be received.
+    unsigned char* GetWritePointer();
+    std::size_t GetWritableSize() const { return mStorage.GetCapacity() - mWritePos; }
+
+    // Mark size bytes of the writable space as received.
+    void Commit(std::size_t size) { mWritePos += size; }
+
+    // Return the data that has been received but not yet consumed.
+    unsigned char const* GetData() const { return mStorage.Get() + mReadPos; }
+    std::size_t GetSize() const { return mWritePos - mReadPos; }
+
+    // Discard size bytes from the front of the received data.
+    void Consume(std::size_t size);
+
+    // Return the number of bytes moved to make space since construction.
+    unsigned long GetBytesCompacted() const { return mBytesCompacted; }
+
+private:
+    AlignedStorage mStorage;
+    std::size_t mMinimumSpace;
+    std::size_t mReadPos = 0;
+    std::size_t mWritePos = 0;
+    unsigned long mBytesCompacted = 0;
+};
+
+// A preallocated buffer of outbound messages waiting to be written.
+//
+// Messages are appended back to back so that everything pending can be
+// handed to the socket in a single write. As with the receive buffer, the
+// positions return to the start whenever the buffer is drained, and pending
+// bytes are only moved when an append would not otherwise fit and no write
+// is in progress (the socket may still be reading from them). Anything
+// that still doesn't fit goes to an overflow area, allocated only when
+// first needed, and is moved into the buffer as writes complete, so an
+// append never fails. Only data in the buffer itself is handed out for
+// writing, so the buffer may be registered with the kernel.
+class SendBuffer
+{
+public:
+    explicit SendBuffer(std::size_t capacity) : mStorage(capacity) {}
+
+    void Append(unsigned char const* data, std::size_t size);
+
+    // Return a pointer to space for a message of the given size, which
+    // must be followed by a call to Commit.
+    unsigned char* Prepare(std::size_t size);
+    void Commit(std::size_t size);
+
+    // Return the data waiting to be written next.
+    unsigned char const* GetData() const { return mStorage.Get() + mReadPos; }
+    std::size_t GetSize() const { return mWritePos - mReadPos; }
+
+    // Return the number of bytes waiting in the overflow area.
+    std::size_t GetOverflowSize() const { return mOverflow.size(); }
+
+    // Bracket a write of the pending data, discarding the bytes written.
+    void BeginWrite() { mIsWriting = true; }
+    void EndWrite(std::size_t written);
+
+    bool IsWriting() const { return mIsWriting; }
+
+    // Return the underlying storage, e.g. for registration with the kernel.
+    const AlignedStorage& GetStorage() const { return mStorage; }
+
+private:
+    void Compact();
+
+    AlignedStorage mStorage;
+    std::size_t mReadPos = 0;
+    std::size_t mWritePos = 0;
+    bool mIsWriting = false;
+    std::vector<unsigned char> mOverflow;
+    std::size_t mOverflowPrepared = 0; // overflow size before Prepare used it
+    bool mIsPreparedInOverflow = false;
+};
+
+inline unsigned char* ReceiveBuffer::GetWritePointer()
+{
+    if (GetWritableSize() < mMinimumSpace && mReadPos != 0)
+    {
+        const std::size_t pending = GetSize();
+        std::memmove(mStorage.Get(), mStorage.Get() + mReadPos, pending);
+        mBytesCompacted += pending;
+        mReadPos = 0;
+        mWritePos = pending;
+    }
+    return mStorage.Get() + mWritePos;
+}
+
+inline void ReceiveBuffer::Consume(std::size_t size)
+{
+    mReadPos += size;
+    if (mReadPos == mWritePos)
+    {
+        mReadPos = mWritePos = 0;
+    }
+}
+
+inline void SendBuffer::Append(unsigned char const* data, std::size_t size)
+{
+    std::memcpy(Prepare(size), data, size);
+    Commit(size);
+}
+
+inline unsigned char* SendBuffer::Prepare(std::size_t size)
+{
+    if (mStorage.GetCapacity() - mWritePos < size && mOverflow.empty() && !mIsWriting)
+    {
+        Compact();
+    }
+    // Anything already in the overflow area has to be written first.
+    if (mStorage.GetCapacity() - mWritePos < size || !mOverflow.empty())
+    {
+        mIsPreparedInOverflow = true;
+        mOverflowPrepared = mOverflow.size();
+        mOverflow.resize(mOverflowPrepared + size);
+        return mOverflow.data() + mOverflowPrepared;
+    }
+    return mStorage.Get() + mWritePos;
+}
+
+inline void SendBuffer::Commit(std::size_t size)
+{
+    if (mIsPreparedInOverflow)
+    {
+        mIsPreparedInOverflow = false;
+        mOverflow.resize(mOverflowPrepared + size);
+    }
+    else
+    {
+        mWritePos += size;
+    }
+}
+
+inline void SendBuffer::EndWrite(std::size_t size)
+{
+    mIsWriting = false;
+    mReadPos += size;
+    if (mReadPos == mWritePos)
+    {
+        mReadPos = mWritePos = 0;
+    }
+    if (!mOverflow.empty())
+    {
+        Compact();
+        const std::size_t moved = std::min(mOverflow.size(), mStorage.GetCapacity() - mWritePos);
+        std::memcpy(mStorage.Get() + mWritePos, mOverflow.data(), moved);
+        mWritePos += moved;
+        mOverflow.erase(mOverflow.begin(), mOverflow.begin() + moved);
+    }
+}
+
+inline void SendBuffer::Compact()
+{
+    const std::size_t pending = GetSize();
+    std::memmove(mStorage.Get(), mStorage.Get() + mReadPos, pending);
+    mReadPos = 0;
+    mWritePos = pending;
+}
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_BUFFERS_H
@@ -0,0 +1,293 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_CODEC_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_CODEC_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+#include <boost/endian/conversion.hpp>
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+#include "types.h"
+
+namespace ReadyTraderGo {
+
+// Each message begins with a two-part header:
+//   1. length - a two-byte, big endian, unsigned integer; and
+//   2. type - a one-byte unsigned integer.
+constexpr std::size_t MESSAGE_HEADER_SIZE = 3;
+constexpr std::size_t MESSAGE_TYPE_OFFSET = 2;
+
+enum MessageFieldSize : std::size_t
+{
+    BYTE = 1,
+    LONG = 4,
+    STRING = 50
+};
+
+// Field encodings. Each provides its encoded SIZE together with Write and
+// Read functions that convert between a member value and its wire format.
+
+struct ByteField
+{
+    static constexpr std::size_t SIZE = MessageFieldSize::BYTE;
+
+    template<typename T>
+    static void Write(unsigned char* buf, T value) { *buf = static_cast<unsigned char>(value); }
+
+    template<typename T>
+    static void Read(unsigned char const* data, T& value) { value = T(*data); }
+};
+
+struct LongField
+{
+    static constexpr std::size_t SIZE = MessageFieldSize::LONG;
+
+    static void Write(unsigned char* buf, unsigned long value)
+    {
+        *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)value);
+    }
+
+    static void Read(unsigned char const* data, unsigned long& value)
+    {
+        value = boost::endian::big_to_native(*(uint32_t*)data);
+    }
+};
+
+struct SignedLongField
+{
+    static constexpr std::size_t SIZE = MessageFieldSize::LONG;
+
+    static void Write(unsigned char* buf, signed long value)
+    {
+        *(int32_t*)buf = boost::endian::native_to_big((int32_t)value);
+    }
+
+    static void Read(unsigned char const* data, signed long& value)
+    {
+        value = boost::endian::big_to_native(*(int32_t*)data);
+    }
+};
+
+// A fixed-length string, padded with zeros.
+struct StringField
+{
+    static constexpr std::size_t SIZE = MessageFieldSize::STRING;
+
+    static void Write(unsigned char* buf, const std::string& value)
+    {
+        auto len = (value.length() < SIZE) ? value.length() : SIZE;
+        std::memcpy(buf, value.c_str(), len);
+        std::memset(buf + len, 0, SIZE - len);
+    }
+
+    static void Read(unsigned char const* data, std::string& value)
+    {
+        auto loc = (decltype(data)) std::memchr(data, 0, SIZE);
+        auto len = (loc != nullptr) ? loc - data : SIZE;
+        value.assign((char const*) data, len);
+    }
+};
+
+// The prices or volumes at each of the top levels of a book. Where the
+// compiler has been allowed to use SSSE3 or AVX2, four longs at a time are
+// byte-swapped with a single shuffle when reading.
+struct LevelsField
+{
+    static constexpr std::size_t SIZE = MessageFieldSize::LONG * TOP_LEVEL_COUNT;
+
+    static void Write(unsigned char* buf, const std::array<unsigned long, TOP_LEVEL_COUNT>& levels)
+    {
+        for (auto l : levels)
+        {
+            LongField::Write(buf, l);
+            buf += MessageFieldSize::LONG;
+        }
+    }
+
+    static void Read(unsigned char const* data, std::array<unsigned long, TOP_LEVEL_COUNT>& levels)
+    {
+        std::size_t i = 0;
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+        const __m128i bswap32 = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+        for (; i + 4 <= TOP_LEVEL_COUNT; i += 4)
+        {
+            const __m128i swapped = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)data), bswap32);
+            if constexpr (sizeof(unsigned long) == 4)
+            {
+                _mm_storeu_si128((__m128i*)&levels[i], swapped);
+            }
+            else
+            {
+#if defined(__AVX2__)
+                _mm256_storeu_si256((__m256i*)&levels[i], _mm256_cvtepu32_epi64(swapped));
+#else
+                const __m128i zero = _mm_setzero_si128();
+                _mm_storeu_si128((__m128i*)&levels[i], _mm_unpacklo_epi32(swapped, zero));
+                _mm_storeu_si128((__m128i*)&levels[i + 2], _mm_unpackhi_epi32(swapped, zero));
+#endif
+            }
+            data += MessageFieldSize::LONG * 4;
+        }
+#endif
+
+        for (; i < TOP_LEVEL_COUNT; ++i)
+        {
+            LongField::Read(data, levels[i]);
+            data += MessageFieldSize::LONG;
+        }
+    }
+};
+
+// A message field: a data member together with its wire encoding.
+template<auto Member, typename E>
+struct Field
+{
+    using Encoding = E;
+
+    static constexpr std::size_t SIZE = Encoding::SIZE;
+
+    template<auto Other>
+    static constexpr bool IS = std::is_same_v<Field, Field<Other, Encoding>>;
+
+    template<typename M>
+    static void Encode(const M& message, unsigned char* buf) { Encoding::Write(buf, message.*Member); }
+
+    template<typename M>
+    static void Decode(M& message, unsigned char const* data) { Encoding::Read(data, message.*Member); }
+};
+
+// The fields of a message body in wire order. Everything here is resolved
+// at compile time, so encoding and decoding inline to a sequence of loads
+// and stores at fixed offsets.
+template<typename... Fields>
+struct MessageSchema
+{
+    static constexpr std::size_t SIZE = (Fields::SIZE + ... + 0);
+
+    template<typename M>
+    static void Encode(const M& message, unsigned char* buf)
+    {
+        ((Fields::Encode(message, buf), buf += Fields::SIZE), ...);
+    }
+
+    template<typename M>
+    static void Decode(M& message, unsigned char const* data)
+    {
+        ((Fields::Decode(message, data), data += Fields::SIZE), ...);
+    }
+
+    // Return the offset of the given member within the message body.
+    template<auto Member>
+    static constexpr std::size_t OffsetOf()
+    {
+        static_assert((Fields::template IS<Member> || ...), "member is not part of this schema");
+        std::size_t offset = 0;
+        bool found = false;
+        ((found = found || Fields::template IS<Member>, offset += found ? 0 : Fields::SIZE), ...);
+        return offset;
+    }
+
+    // Return the position of the given member within the schema.
+    template<auto Member>
+    static constexpr std::size_t IndexOf()
+    {
+        std::size_t index = 0;
+        bool found = false;
+        ((found = found || Fields::template IS<Member>, index += found ? 0 : 1), ...);
+        return index;
+    }
+
+    // Overwrite a single member in an already encoded message body.
+    template<auto Member, typename T>
+    static void Put(unsigned char* body, const T& value)
+    {
+        using F = std::tuple_element_t<IndexOf<Member>(), std::tuple<Fields...>>;
+        F::Encoding::Write(body + OffsetOf<Member>(), value);
+    }
+};
+
+// Specialised for each message to provide its TYPE and Schema.
+template<typename M>
+struct MessageTraits;
+
+// Return the size of a message, including its header.
+template<typename M>
+constexpr std::size_t messageSize()
+{
+    return MESSAGE_HEADER_SIZE + MessageTraits<M>::Schema::SIZE;
+}
+
+// Write a message, including its header, to the given buffer, which must
+// have room for at least messageSize<M>() bytes.
+template<typename M>
+inline void encodeMessage(const M& message, unsigned char* buf)
+{
+    *(uint16_t*)buf = boost::endian::native_to_big((uint16_t)messageSize<M>());
+    buf[MESSAGE_TYPE_OFFSET] = MessageTraits<M>::TYPE;
+    MessageTraits<M>::Schema::Encode(message, buf + MESSAGE_HEADER_SIZE);
+}
+
+// Read a message from the given message body (i.e. excluding its header).
+template<typename M>
+inline M decodeMessage(unsigned char const* data)
+{
+    M message;
+    MessageTraits<M>::Schema::Decode(message, data);
+    return message;
+}
+
+// A fully encoded message, header included, that can be sent repeatedly
+// with individual fields patched in place. Fields that never change for a
+// given use (e.g. the side or lifespan of an order) are encoded once, when
+// the template is constructed.
+template<typename M>
+class MessageTemplate
+{
+public:
+    static constexpr std::size_t SIZE = messageSize<M>();
+
+    MessageTemplate() : MessageTemplate(M{}) {}
+    explicit MessageTemplate(const M& prototype) { encodeMessage(prototype, mFrame.data()); }
+
+    template<auto Member, typename T>
+    void Set(const T& value)
+    {
+        MessageTraits<M>::Schema::template Put<Member>(mFrame.data() + MESSAGE_HEADER_SIZE, value);
+    }
+
+    unsigned char const* GetData() const { return mFrame.data(); }
+    static constexpr std::size_t GetSize() { return SIZE; }
+
+private:
+    std::array<unsigned char, SIZE> mFrame;
+};
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_CODEC_H
@@ -18,10 +18,16 @@
 #ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_CONFIG_H
 #define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_CONFIG_H
 
+#include <chrono>
+#include <cstddef>
 #include <string>
 
 #include <boost/property_tree/ptree.hpp>
 
+#include "connectivitytypes.h"
+#include "riskengine.h"
+#include "threading.h"
+
 namespace ReadyTraderGo {
 
 struct Config
@@ -30,9 +36,54 @@ struct Config
     {
         mExecHost = tree.get<std::string>("Execution.Host");
         mExecPort = tree.get<unsigned short>("Execution.Port");
+        mExecTransport = tree.get<std::string>("Execution.Transport", "tcp");
+        mExecName = tree.get<std::string>("Execution.Name", "exec.dat");
+        mExecBusyPoll = tree.get<unsigned int>("Execution.BusyPoll", 0);
+        mExecRingEntries = tree.get<unsigned int>("Execution.RingEntries", 64);
+        mExecSqPoll = tree.get<bool>("Execution.SqPoll", false);
+        mExecSqPollIdle = tree.get<unsigned int>("Execution.SqPollIdle", 10);
+        mExecReceiveBufferCount = tree.get<unsigned int>("Execution.ReceiveBufferCount", 16);
+        mExecReceiveBufferSize = tree.get<std::size_t>("Execution.ReceiveBufferSize", 4096);
+        mExecCommandQueueCapacity = tree.get<std::size_t>("Execution.CommandQueueCapacity", 1024);
 
         mInfoType = tree.get<std::string>("Information.Type");
         mInfoName = tree.get<std::string>("Information.Name");
+        mInfoRingSize = tree.get<std::size_t>("Information.RingSize", 0);
+        mInfoPollPolicy = tree.get<std::string>("Information.PollPolicy", "spin");
+        mInfoSpinCount = tree.get<unsigned long>("Information.SpinCount", 100);
+        mInfoSleepInterval = tree.get<unsigned long>("Information.SleepInterval", 50);
+        mInfoMaxBatch = tree.get<unsigned long>("Information.MaxBatch", 64);
+        mInfoPrefault = tree.get<bool>("Information.Prefault", true);
+        mInfoLock = tree.get<bool>("Information.Lock", false);
+        mInfoHugePages = tree.get<bool>("Information.HugePages", false);
+        mInfoReceiveBufferSize = tree.get<std::size_t>("Information.ReceiveBufferSize", 4194304);
+        mInfoInterface = tree.get<std::string>("Information.Interface", "");
+        mInfoTimestamps = tree.get<bool>("Information.Timestamps", true);
+
+        mPipeline = tree.get<bool>("Threading.Pipeline", false);
+        mPipelineQueueCapacity = tree.get<std::size_t>("Threading.PipelineQueueCapacity", 4096);
+        mPipelineYield = tree.get<bool>("Threading.PipelineYield", false);
+        mFeedThread.readFromPropertyTree(tree, "Threading.Feed");
+        mGatewayThread.readFromPropertyTree(tree, "Threading.Gateway");
+
+        mLimits.mEnabled = tree.get<bool>("Limits.Enabled", true);
+        mLimits.mActiveOrderCountLimit = tree.get<std::size_t>("Limits.ActiveOrderCountLimit", 10);
+        mLimits.mActiveVolumeLimit = tree.get<unsigned long>("Limits.ActiveVolumeLimit", 200);
+        mLimits.mPositionLimit = tree.get<signed long>("Limits.PositionLimit", 100);
+        // Engine.Speed must match the exchange's. The exchange divides the
+        // interval by the speed and then measures it in game time, which runs
+        // speed times faster than real time, so the real-time window is the
+        // interval divided by the speed squared. A non-positive speed is
+        // rejected when the configuration is validated.
+        mSpeed = tree.get<double>("Engine.Speed", 1.0);
+        double interval = tree.get<double>("Limits.MessageFrequencyInterval", 1.0);
+        if (mSpeed > 0.0)
+            interval /= mSpeed * mSpeed;
+        mLimits.mMessageFrequencyInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(interval));
+        mLimits.mMessageFrequencyMargin = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(tree.get<double>("Limits.MessageFrequencyMargin", 0.01)));
+        mLimits.mMessageFrequencyLimit = tree.get<std::size_t>("Limits.MessageFrequencyLimit", 50);
 
         mTeamName = tree.get<std::string>("TeamName");
         mSecret = tree.get<std::string>("Secret");
@@ -40,9 +91,38 @@ struct Config
 
     std::string mExecHost;
     unsigned short mExecPort;
+    std::string mExecTransport;
+    std::string mExecName; // the shared-memory channel
+    unsigned int mExecBusyPoll; // microseconds, tcp only
+    unsigned int mExecRingEntries;
+    bool mExecSqPoll;
+    unsigned int mExecSqPollIdle; // milliseconds
+    unsigned int mExecReceiveBufferCount;
+    std::size_t mExecReceiveBufferSize;
+    std::size_t mExecCommandQueueCapacity; // orders submitted from other threads
 
     std::string mInfoType;
     std::string mInfoName;
+    std::size_t mInfoRingSize; // zero, or else the size of the mapped file
+    std::string mInfoPollPolicy;
+    unsigned long mInfoSpinCount;
+    unsigned long mInfoSleepInterval; // microseconds
+    unsigned long mInfoMaxBatch;
+    bool mInfoPrefault; // mmap and shm only
+    bool mInfoLock; // mmap and shm only
+    bool mInfoHugePages; // mmap and shm only
+    std::size_t mInfoReceiveBufferSize; // bytes, UDP only
+    std::string mInfoInterface; // UDP multicast only
+    bool mInfoTimestamps; // UDP only
+
+    bool mPipeline; // run the feed and gateway on threads of their own
+    std::size_t mPipelineQueueCapacity;
+    bool mPipelineYield; // yield, rather than spin, when a pipeline thread is idle
+    ThreadSettings mFeedThread;
+    ThreadSettings mGatewayThread;
+
+    double mSpeed; // the exchange's Engine.Speed
+    RiskLimits mLimits; // checked before each order is sent
 
     std::string mTeamName;
     std::string mSecret;
@@ -15,12 +15,22 @@
 //     You should have received a copy of the GNU Affero General Public
 //     License along with Ready Trader Go.  If not, see
 //     <https://www.gnu.org/licenses/>.
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
 #include <cstddef>
+#include <cstring>
 #include <iomanip>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
 #include <boost/asio/connect.hpp>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/error.hpp>
@@ -29,11 +39,19 @@
 #include <boost/endian/conversion.hpp>
 #include <boost/interprocess/file_mapping.hpp>
 #include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
 #include <boost/system/error_code.hpp>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/socket.h>
+#endif
+
 #include "connectivity.h"
 #include "error.h"
 #include "logging.h"
+#include "protocol.h"
+#include "types.h"
 
 namespace error = boost::asio::error;
 namespace interprocess = boost::interprocess;
@@ -44,13 +62,90 @@ RTG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_CON, "CON")
 
 namespace ReadyTraderGo {
 
-// Theoretical maximum size of an (IPv4) UDP packet (actual maximum is lower).
-constexpr std::size_t READ_SIZE = 65535;
+// The largest information message is an order book update or trade ticks.
+constexpr std::size_t MAXIMUM_INFORMATION_MESSAGE_SIZE = messageSize<OrderBookMessage>();
+static_assert(FRAME_HEADER_SIZE + MAXIMUM_INFORMATION_MESSAGE_SIZE <= FRAME_SIZE,
+              "information messages must fit in a frame");
+
+// The size of a transparent huge page on x86-64 and most arm64 kernels.
+constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// Hint to the processor that we are in a spin-wait loop.
+static inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+static inline void prefetch(void const* addr)
+{
+#if defined(__GNUC__)
+    __builtin_prefetch(addr);
+#endif
+}
+
+// The publisher sets a frame's spinlock once the frame is fully written.
+static inline bool isFrameReady(unsigned char const* frame)
+{
+    return *(volatile unsigned char const*)frame != 0;
+}
+
+static inline unsigned long getFrameNumber(unsigned char const* frame)
+{
+    return boost::endian::big_to_native(*(volatile uint32_t const*)frame) & FRAME_NUMBER_MASK;
+}
+
+static inline bool isPowerOfTwo(std::size_t n)
+{
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+bool SequenceTracker::Check(unsigned char messageType,
+                            unsigned char const* data,
+                            std::size_t size,
+                            unsigned long& expected,
+                            unsigned long& received)
+{
+    if ((messageType != MessageType::ORDER_BOOK_UPDATE && messageType != MessageType::TRADE_TICKS)
+        || size < MessageFieldSize::BYTE + MessageFieldSize::LONG)
+    {
+        return true;
+    }
+
+    const unsigned char instrument = data[0];
+    if (instrument > static_cast<unsigned char>(Instrument::ETF))
+    {
+        return true;
+    }
+
+    auto& last = mLastSequence[messageType - MessageType::ORDER_BOOK_UPDATE][instrument];
+    expected = last + 1;
+    received = boost::endian::big_to_native(*(uint32_t*)(data + MessageFieldSize::BYTE));
+
+    // The first message of each kind establishes the starting point. Trade
+    // ticks are numbered consecutively, but order books are numbered by the
+    // exchange's tick and the exchange skips ticks when it falls behind, so
+    // only a book that goes backwards is out of sequence.
+    bool inSequence;
+    if (messageType == MessageType::TRADE_TICKS)
+    {
+        inSequence = (last == 0 || received == expected);
+    }
+    else
+    {
+        inSequence = (last == 0 || received > last);
+    }
+    last = received;
+    return inSequence;
+}
 
 Connection::Connection(boost::asio::io_context& context, tcp::socket&& socket)
     : mContext(context),
-      mInBuffer(),
-      mOutBuffer(),
+      mInBuffer(RECEIVE_BUFFER_SIZE, MAXIMUM_MESSAGE_SIZE),
+      mOutBuffer(SEND_BUFFER_SIZE),
       mSocket(std::move(socket))
 {
     SetName('\'' + std::to_string(mSocket.local_endpoint().port()) + '\'');
@@ -58,7 +153,19 @@ Connection::Connection(boost::asio::io_context& context, tcp::socket&& socket)
 
 Connection::~Connection()
 {
-    RLOG(LG_CON, LogLevel::LL_INFO) << std::quoted(mName, '\'') << " closing";
+    RLOG(LG_CON, LogLevel::LL_INFO) << std::quoted(mName, '\'') << " closing: messages="
+                                    << mStatistics.mMessagesSent << " bytes=" << mStatistics.mBytesSent
+                                    << " flushes=" << mStatistics.mFlushes
+                                    << " inline_writes=" << mStatistics.mInlineWrites
+                                    << " blocked_writes=" << mStatistics.mBlockedWrites
+                                    << " async_writes=" << mStatistics.mAsyncWrites
+                                    << " max_pending=" << mStatistics.mMaxPending
+                                    << " handler_allocations="
+                                    << mReadMemory.GetAllocations() + mWriteMemory.GetAllocations()
+                                       + mSendMemory.GetAllocations()
+                                    << " heap_allocations="
+                                    << mReadMemory.GetHeapAllocations() + mWriteMemory.GetHeapAllocations()
+                                       + mSendMemory.GetHeapAllocations();
     if (mSocket.is_open())
     {
         mSocket.close();
@@ -67,10 +174,10 @@ Connection::~Connection()
 
 void Connection::AsyncRead()
 {
-    auto buf = mInBuffer.prepare(READ_SIZE);
+    auto* buf = mInBuffer.GetWritePointer();
     mSocket.async_read_some(
-        buf,
-        [this](auto& error, auto size) { ReadSomeHandler(error, size); });
+        boost::asio::buffer(buf, mInBuffer.GetWritableSize()),
+        makeAllocatingHandler(mReadMemory, [this](auto& error, auto size) { ReadSomeHandler(error, size); }));
 }
 
 void Connection::ReadSomeHandler(const boost::system::error_code& error, std::size_t size)
@@ -99,37 +206,80 @@ void Connection::ReadSomeHandler(const boost::system::error_code& error, std::si
 
     RLOG(LG_CON, LogLevel::LL_DEBUG) << std::quoted(mName, '\'') << " received " << size
                                      << " bytes";
-    mInBuffer.commit(size);
-
-    auto* const begin = (unsigned char const*) mInBuffer.data().data();
-    auto* upto = begin;
-    auto available = size;
+    mInBuffer.Commit(size);
 
-    while (available >= MESSAGE_HEADER_SIZE)
+    // Parse everything received so far, including the start of any message
+    // that was incomplete at the end of the previous read.
+    const std::size_t consumed = DeliverMessages(mInBuffer.GetData(), mInBuffer.GetSize());
+    if (consumed == INVALID_MESSAGE)
     {
-        const std::size_t messageLength = boost::endian::big_to_native(*(uint16_t*)upto);
-        if (available < messageLength)
-            break;
+        RLOG(LG_CON, LogLevel::LL_ERROR) << std::quoted(mName, '\'') << " received message with invalid length";
+        OnDisconnect();
+        return;
+    }
 
-        const unsigned char messageType = upto[MESSAGE_TYPE_OFFSET];
-        RLOG(LG_CON, LogLevel::LL_DEBUG) << std::quoted(mName, '\'')
-                                         << " received message with type=" << static_cast<int>(messageType)
-                                         << " and size=" << messageLength;
-        OnMessageReceipt(messageType, upto + MESSAGE_HEADER_SIZE, messageLength - MESSAGE_HEADER_SIZE);
+    mInBuffer.Consume(consumed);
+    AsyncRead();
+}
 
-        upto += messageLength;
-        available -= messageLength;
+void Connection::Flush()
+{
+    if (!mOutBuffer.IsWriting() && mOutBuffer.GetSize() > 0)
+    {
+        Send();
     }
+}
 
-    mInBuffer.consume(upto - begin);
-    AsyncRead();
+void Connection::QueueMessage(std::size_t size, SendMode mode)
+{
+    mStatistics.mMessagesSent++;
+    const std::size_t pending = mOutBuffer.GetSize() + mOutBuffer.GetOverflowSize();
+    if (pending > mStatistics.mMaxPending)
+    {
+        mStatistics.mMaxPending = pending;
+    }
+    if (!IsBatching() && !mOutBuffer.IsWriting())
+    {
+        Send(mode);
+    }
 }
 
 void Connection::Send()
 {
-    mIsSending = true;
-    mSocket.async_write_some(mOutBuffer.data(),
-                             [this](auto& err, auto sz) { WriteSomeHandler(err, sz); });
+    mStatistics.mFlushes++;
+
+    // The socket is non-blocking, so try writing directly from the calling
+    // thread first: usually the kernel accepts everything and the message
+    // leaves without an asynchronous operation or completion handler.
+    boost::system::error_code error;
+    mOutBuffer.BeginWrite();
+    auto size = mSocket.write_some(boost::asio::buffer(mOutBuffer.GetData(), mOutBuffer.GetSize()), error);
+    if (error)
+    {
+        if (error != error::interrupted && error != error::would_block && error != error::try_again)
+        {
+            RLOG(LG_CON, LogLevel::LL_ERROR) << std::quoted(mName, '\'') << " send failed: "
+                                             << error.message();
+            throw ReadyTraderGoError("send failed: " + error.message());
+        }
+        size = 0;
+    }
+
+    if (size > 0)
+    {
+        mStatistics.mInlineWrites++;
+    }
+    else
+    {
+        mStatistics.mBlockedWrites++;
+    }
+    mStatistics.mBytesSent += size;
+    mOutBuffer.EndWrite(size);
+    if (mOutBuffer.GetSize() > 0)
+    {
+        // The kernel's send buffer is full, carry on asynchronously.
+        Write();
+    }
 }
 
 void Connection::Send(SendMode mode)
@@ -140,30 +290,38 @@ void Connection::Send(SendMode mode)
     }
     else if (!mIsSendPosted)
     {
-        boost::asio::post(mContext, [this] {
+        boost::asio::post(mContext, makeAllocatingHandler(mSendMemory, [this] {
             mIsSendPosted = false;
-            if (!mIsSending)
-            {
-                Send();
-            }
-        });
+            Flush();
+        }));
         mIsSendPosted = true;
     }
 }
 
+void Connection::SendFrame(unsigned char const* frame, std::size_t size, SendMode mode)
+{
+    mOutBuffer.Append(frame, size);
+    QueueMessage(size, mode);
+}
+
 void Connection::SendMessage(unsigned char messageType, const ISerialisable& serialisable, SendMode mode)
 {
     const std::size_t size = MESSAGE_HEADER_SIZE + serialisable.Size();
-    auto buf = mOutBuffer.prepare(size);
-    auto* data = static_cast<unsigned char*>(buf.data());
+    auto* data = mOutBuffer.Prepare(size);
     *(uint16_t*)data = boost::endian::native_to_big((uint16_t)size);
     data[MESSAGE_TYPE_OFFSET] = messageType;
     serialisable.Serialise(data + MESSAGE_HEADER_SIZE);
-    mOutBuffer.commit(size);
-    if (!mIsSending)
-    {
-        Send(mode);
-    }
+    mOutBuffer.Commit(size);
+    QueueMessage(size, mode);
+}
+
+void Connection::Write()
+{
+    mStatistics.mAsyncWrites++;
+    mOutBuffer.BeginWrite();
+    mSocket.async_write_some(boost::asio::buffer(mOutBuffer.GetData(), mOutBuffer.GetSize()),
+                             makeAllocatingHandler(mWriteMemory,
+                                                   [this](auto& err, auto sz) { WriteSomeHandler(err, sz); }));
 }
 
 void Connection::WriteSomeHandler(const boost::system::error_code& error, std::size_t size)
@@ -178,43 +336,59 @@ void Connection::WriteSomeHandler(const boost::system::error_code& error, std::s
         }
         RLOG(LG_CON, LogLevel::LL_DEBUG) << std::quoted(mName, '\'') << " send interrupted: "
                                          << error.message();
+        size = 0;
     }
     else
     {
         RLOG(LG_CON, LogLevel::LL_DEBUG) << std::quoted(mName, '\'') << " sent "
                                          << size << " bytes";
-        mOutBuffer.consume(size);
+        mStatistics.mBytesSent += size;
     }
 
-    if (mOutBuffer.size() > 0)
-    {
-        mSocket.async_write_some(
-            mOutBuffer.data(), [this](auto& err, auto sz) { WriteSomeHandler(err, sz); });
-    }
-    else
+    mOutBuffer.EndWrite(size);
+    if (mOutBuffer.GetSize() > 0)
     {
-        mIsSending = false;
+        Write();
     }
 }
 
-Subscription::Subscription(boost::asio::io_context& context, interprocess::file_mapping& file, interprocess::mapped_region& region)
-    : mContext(context), mFile(std::move(file)), mRegion(std::move(region))
+Subscription::Subscription(boost::asio::io_context& context,
+                           const std::string& name,
+                           interprocess::mapped_region& region,
+                           const SubscriptionSettings& settings)
+    : mContext(context),
+      mRegion(std::move(region)),
+      mSettings(settings),
+      mRingMask(settings.mRingSize - 1),
+      mTimer(context)
 {
-    SetName(std::string(mFile.get_name()));
+    SetName(name);
 }
 
 Subscription::~Subscription()
 {
-    RLOG(LG_CON, LogLevel::LL_INFO) << std::quoted(mName, '\'') << " closing";
+    RLOG(LG_CON, LogLevel::LL_INFO) << std::quoted(mName, '\'') << " closing: frames="
+                                    << mStatistics.mFramesReceived << " batches="
+                                    << mStatistics.mBatches << " empty_polls="
+                                    << mStatistics.mEmptyPolls << " backoffs="
+                                    << mStatistics.mBackoffs << " overruns="
+                                    << mStatistics.mOverruns << " sequence_gaps="
+                                    << mStatistics.mSequenceGaps << " handler_allocations="
+                                    << mReceiveMemory.GetAllocations() << " heap_allocations="
+                                    << mReceiveMemory.GetHeapAllocations();
 }
 
 void Subscription::AsyncReceive()
 {
-    std::weak_ptr<ISubscription> weak_this = shared_from_this();
-    mContext.post([this, weak_this](){ AsyncReceive(0, weak_this); });
+    if (mSettings.mIsPolledExternally)
+    {
+        return;
+    }
+
+    PostReceive(shared_from_this());
 }
 
-void Subscription::AsyncReceive(unsigned long pos, std::weak_ptr<ISubscription> weak_this)
+void Subscription::AsyncReceive(std::weak_ptr<ISubscription> weak_this)
 {
     if (weak_this.expired())
     {
@@ -222,24 +396,184 @@ void Subscription::AsyncReceive(unsigned long pos, std::weak_ptr<ISubscription>
         return;
     }
 
-    unsigned char* addr = ((unsigned char*)mRegion.get_address()) + pos;
+    unsigned char* const addr = (unsigned char*)mRegion.get_address() + mPosition;
+
+    // Spin on the frame for a while before going back to the io_context, so
+    // that an empty ring doesn't cost a posted handler per check.
+    unsigned long spins = 0;
+    while (!isFrameReady(addr))
+    {
+        if (spins == mSettings.mSpinCount)
+        {
+            mStatistics.mEmptyPolls += spins + 1;
+            Backoff(std::move(weak_this));
+            return;
+        }
+        ++spins;
+        cpuRelax();
+    }
+    mStatistics.mEmptyPolls += spins;
+
+    Deliver();
+
+    PostReceive(std::move(weak_this));
+}
+
+std::size_t Subscription::Poll()
+{
+    if (!isFrameReady((unsigned char*)mRegion.get_address() + mPosition))
+    {
+        ++mStatistics.mEmptyPolls;
+        return 0;
+    }
+    return Deliver();
+}
 
-    if (addr[0] != 0)
+std::size_t Subscription::Deliver()
+{
+    unsigned char* const base = (unsigned char*)mRegion.get_address();
+    unsigned long pos = mPosition;
+    unsigned char* addr = base + pos;
+    std::array<unsigned char, MAXIMUM_INFORMATION_MESSAGE_SIZE> payload;
+
+    // Deliver every frame that is already waiting (up to the batch limit)
+    // before going back to the io_context, so a burst of updates isn't
+    // interleaved with a round trip through the handler queue.
+    unsigned long count = 0;
+    while (count < mSettings.mMaxBatch && isFrameReady(addr))
     {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        unsigned long frameNumber = getFrameNumber(addr);
+
+        // A frame number other than the one we expect means the publisher
+        // has lapped us and overwritten frames we hadn't read, however many
+        // laps ahead it is. Skip straight to the newest frame.
+        if (mHasReceived && frameNumber != mFrameNumber)
+        {
+            pos = Resynchronise(pos);
+            addr = base + pos;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            frameNumber = getFrameNumber(addr);
+        }
+
+        const unsigned long next = NextFrame(pos);
+        unsigned char* nextAddr = base + next;
+        prefetch(nextAddr);
+
+        // Copy the payload out and then check that the publisher didn't start
+        // overwriting the frame while we were reading it. If it did, the next
+        // pass finds a newer frame number here and resynchronises.
         const uint32_t* payload_size_ptr = (uint32_t*)(addr + FRAME_PAYLOAD_SIZE_OFFSET);
         const std::size_t payloadSize = boost::endian::big_to_native(*payload_size_ptr);
-        ReceiveFromHandler(addr + FRAME_HEADER_SIZE, payloadSize);
-        pos = (pos + FRAME_SIZE) & (SUBSCRIPTION_TRANSPORT_BUFFER_SIZE - 1);
+        const std::size_t copySize = std::min(payloadSize, payload.size());
+        std::memcpy(payload.data(), addr + FRAME_HEADER_SIZE, copySize);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!isFrameReady(addr) || getFrameNumber(addr) != frameNumber)
+        {
+            mFrameNumber = frameNumber;
+            mHasReceived = true;
+            continue;
+        }
+
+        if (payloadSize == copySize)
+        {
+            ReceiveFromHandler(payload.data(), payloadSize);
+        }
+        else
+        {
+            RLOG(LG_CON, LogLevel::LL_ERROR) << std::quoted(mName, '\'') << " frame payload size "
+                                             << payloadSize << " exceeds maximum message size "
+                                             << payload.size();
+        }
+        mFrameNumber = (frameNumber + 1) & FRAME_NUMBER_MASK;
+        mHasReceived = true;
+
+        pos = next;
+        addr = nextAddr;
+        ++count;
     }
 
-    mContext.post([this, pos, weak_this](){ AsyncReceive(pos, weak_this); });
+    mPosition = pos;
+    mStatistics.mFramesReceived += count;
+    ++mStatistics.mBatches;
+    return count;
 }
 
-void Subscription::ReceiveFromHandler(unsigned char const* data, std::size_t size)
+void Subscription::Backoff(std::weak_ptr<ISubscription> weak_this)
+{
+    ++mStatistics.mBackoffs;
+
+    switch (mSettings.mPollPolicy)
+    {
+    case PollPolicy::SPIN:
+        break;
+    case PollPolicy::YIELD:
+        std::this_thread::yield();
+        break;
+    case PollPolicy::SLEEP:
+        // Waiting on a timer lets the io_context block in the reactor, so the
+        // execution connection is still serviced while the feed is quiet.
+        mTimer.expires_after(mSettings.mSleepInterval);
+        mTimer.async_wait(makeAllocatingHandler(mReceiveMemory, [this, weak_this](const auto& error) {
+            if (!error)
+            {
+                AsyncReceive(weak_this);
+            }
+        }));
+        return;
+    }
+
+    PostReceive(std::move(weak_this));
+}
+
+void Subscription::PostReceive(std::weak_ptr<ISubscription> weak_this)
+{
+    boost::asio::post(mContext, makeAllocatingHandler(mReceiveMemory, [this, weak_this = std::move(weak_this)]() {
+        AsyncReceive(weak_this);
+    }));
+}
+
+unsigned long Subscription::Resynchronise(unsigned long pos)
+{
+    auto* const base = (unsigned char const*)mRegion.get_address();
+    unsigned long newest = pos;
+    unsigned long newestNumber = getFrameNumber(base + pos);
+
+    // Frames written since the publisher lapped us carry consecutive frame
+    // numbers, so the newest is the last one before that run is broken.
+    for (unsigned long next = NextFrame(pos);
+         next != pos && isFrameReady(base + next)
+         && getFrameNumber(base + next) == ((newestNumber + 1) & FRAME_NUMBER_MASK);
+         next = NextFrame(next))
+    {
+        newest = next;
+        newestNumber = (newestNumber + 1) & FRAME_NUMBER_MASK;
+    }
+
+    const std::size_t skipped = (newestNumber - mFrameNumber) & FRAME_NUMBER_MASK;
+    mFrameNumber = newestNumber;
+
+    ++mStatistics.mOverruns;
+    mStatistics.mFramesSkipped += skipped;
+    RLOG(LG_CON, LogLevel::LL_WARNING) << std::quoted(mName, '\'') << " fell a whole ring behind the publisher,"
+                                       << " skipping " << skipped << " frames";
+    OnOverrun(skipped);
+
+    return newest;
+}
+
+void MessageSubscription::ReceiveFromHandler(unsigned char const* data, std::size_t size)
 {
     RLOG(LG_CON, LogLevel::LL_DEBUG) << std::quoted(mName, '\'') << " received "
                                      << size << " bytes";
 
+    if (size < MESSAGE_HEADER_SIZE)
+    {
+        RLOG(LG_CON, LogLevel::LL_ERROR) << std::quoted(mName, '\'') << " message of " << size
+                                         << " bytes is too short";
+        return;
+    }
+
     const std::size_t messageLength = boost::endian::big_to_native(*(uint16_t*)data);
     const unsigned char messageType = data[MESSAGE_TYPE_OFFSET];
 
@@ -254,13 +588,32 @@ void Subscription::ReceiveFromHandler(unsigned char const* data, std::size_t siz
     RLOG(LG_CON, LogLevel::LL_DEBUG) << std::quoted(mName, '\'')
                                      << " received message with type=" << static_cast<int>(messageType)
                                      << " and size=" << messageLength;
+
+    unsigned long expected;
+    unsigned long received;
+    if (!mSequenceTracker.Check(messageType, data + MESSAGE_HEADER_SIZE, messageLength - MESSAGE_HEADER_SIZE,
+                                expected, received))
+    {
+        ++mStatistics.mSequenceGaps;
+        if (received > expected)
+        {
+            mStatistics.mMessagesMissed += received - expected;
+        }
+        RLOG(LG_CON, LogLevel::LL_WARNING) << std::quoted(mName, '\'')
+                                           << " sequence gap for message with type=" << static_cast<int>(messageType)
+                                           << " and instrument=" << static_cast<int>(data[MESSAGE_HEADER_SIZE])
+                                           << ": expected=" << expected << " received=" << received;
+        OnSequenceGap(messageType, data[MESSAGE_HEADER_SIZE], expected, received);
+    }
+
     OnMessageReceipt(messageType, data + MESSAGE_HEADER_SIZE, messageLength - MESSAGE_HEADER_SIZE);
 }
 
 ConnectionFactory::ConnectionFactory(boost::asio::io_context& context,
                                      std::string host,
-                                     unsigned short port)
-    : mContext(context), mHost(std::move(host)), mPort(port)
+                                     unsigned short port,
+                                     unsigned int busyPoll)
+    : mContext(context), mHost(std::move(host)), mPort(port), mBusyPoll(busyPoll)
 {
     boost::system::error_code error;
     tcp::resolver resolver(mContext);
@@ -285,6 +638,11 @@ static std::basic_ostream<C, T>& operator<<(std::basic_ostream<C, T>& strm, cons
 }
 
 std::unique_ptr<IConnection> ConnectionFactory::Create()
+{
+    return std::make_unique<Connection>(mContext, Connect());
+}
+
+tcp::socket ConnectionFactory::Connect()
 {
     boost::system::error_code error;
     tcp::socket sock(mContext);
@@ -305,21 +663,132 @@ std::unique_ptr<IConnection> ConnectionFactory::Create()
     // It's not the end of the world if this fails, so any error is ignored.
     sock.set_option(tcp::no_delay(true), error);
 
-    return std::make_unique<Connection>(mContext, std::move(sock));
+    if (mBusyPoll != 0)
+    {
+#ifdef SO_BUSY_POLL
+        // Have receives and readiness checks spin on the device queue for up
+        // to this many microseconds rather than wait for an interrupt.
+        const int busyPoll = static_cast<int>(mBusyPoll);
+        if (setsockopt(sock.native_handle(), SOL_SOCKET, SO_BUSY_POLL, &busyPoll, sizeof(busyPoll)) != 0)
+        {
+            RLOG(LG_CON, LogLevel::LL_WARNING) << "unable to set SO_BUSY_POLL to " << mBusyPoll << ": "
+                                               << std::strerror(errno);
+        }
+#else
+        RLOG(LG_CON, LogLevel::LL_WARNING) << "SO_BUSY_POLL is not supported on this platform";
+#endif
+    }
+
+    return sock;
 }
 
 SubscriptionFactory::SubscriptionFactory(boost::asio::io_context& context,
                                          const std::string& type,
-                                         const std::string& name)
-    : mContext(context), mType(type), mName(name)
+                                         const std::string& name,
+                                         const SubscriptionSettings& settings)
+    : mContext(context), mType(type), mName(name), mSettings(settings)
 {
 }
 
-std::shared_ptr<ISubscription> SubscriptionFactory::Create()
+interprocess::mapped_region SubscriptionFactory::Map() const
 {
+    interprocess::map_options_t options = interprocess::default_map_options;
+#ifdef MAP_POPULATE
+    // Have the kernel fill in the page tables for the whole mapping now,
+    // rather than on first touch.
+    if (mSettings.mPrefault)
+    {
+        options = MAP_POPULATE;
+    }
+#endif
+
+    if (mType == "shm")
+    {
+        interprocess::shared_memory_object shm{interprocess::open_only, mName.c_str(), interprocess::read_only};
+        return interprocess::mapped_region{shm, interprocess::read_only, 0, 0, nullptr, options};
+    }
+
     interprocess::file_mapping file{mName.c_str(), interprocess::read_only};
-    interprocess::mapped_region region{file, interprocess::read_only};
-    return std::make_shared<Subscription>(mContext, file, region);
+    return interprocess::mapped_region{file, interprocess::read_only, 0, 0, nullptr, options};
+}
+
+void SubscriptionFactory::Prepare(interprocess::mapped_region& region) const
+{
+    auto* const base = static_cast<unsigned char const*>(region.get_address());
+    const std::size_t size = region.get_size();
+
+    if (mSettings.mHugePages)
+    {
+#ifdef MADV_HUGEPAGE
+        if (size < HUGE_PAGE_SIZE)
+        {
+            RLOG(LG_CON, LogLevel::LL_WARNING) << std::quoted(mName, '\'') << " is smaller than a huge page";
+        }
+        else if (madvise(region.get_address(), size, MADV_HUGEPAGE) != 0)
+        {
+            RLOG(LG_CON, LogLevel::LL_WARNING) << "huge pages unavailable for " << std::quoted(mName, '\'')
+                                               << ": " << std::strerror(errno);
+        }
+#else
+        RLOG(LG_CON, LogLevel::LL_WARNING) << "huge pages are not supported on this platform";
+#endif
+    }
+
+    if (mSettings.mPrefault)
+    {
+        // Touch every page, which is all the prefaulting there is where
+        // MAP_POPULATE isn't available and costs nothing where it is.
+        const std::size_t pageSize = interprocess::mapped_region::get_page_size();
+        unsigned char sum = 0;
+        for (std::size_t offset = 0; offset < size; offset += pageSize)
+        {
+            sum += *(volatile unsigned char const*)(base + offset);
+        }
+        (void)sum;
+    }
+
+    if (mSettings.mLock)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        if (mlock(region.get_address(), size) != 0)
+        {
+            throw ReadyTraderGoError("unable to lock '" + mName + "' in memory: " + std::strerror(errno)
+                                     + " (check the locked memory limit)");
+        }
+#else
+        RLOG(LG_CON, LogLevel::LL_WARNING) << "memory locking is not supported on this platform";
+#endif
+    }
+}
+
+std::shared_ptr<ISubscription> SubscriptionFactory::Create()
+{
+    interprocess::mapped_region region = Map();
+    Prepare(region);
+
+    // The publisher wraps at the end of the mapping, so the ring is always
+    // the whole of it. A configured ring size is only there to be checked.
+    SubscriptionSettings settings = mSettings;
+    if (settings.mRingSize != 0 && settings.mRingSize != region.get_size())
+    {
+        throw ReadyTraderGoError("information ring size " + std::to_string(settings.mRingSize)
+                                 + " differs from the size of '" + mName + "' ("
+                                 + std::to_string(region.get_size()) + " bytes)");
+    }
+    settings.mRingSize = region.get_size();
+
+    RLOG(LG_CON, LogLevel::LL_INFO) << "mapped " << mType << " " << std::quoted(mName, '\'')
+                                    << ": ring size=" << settings.mRingSize << std::boolalpha
+                                    << " prefault=" << settings.mPrefault << " lock=" << settings.mLock
+                                    << " huge_pages=" << settings.mHugePages;
+
+    if (!isPowerOfTwo(settings.mRingSize) || settings.mRingSize < 2 * FRAME_SIZE)
+    {
+        throw ReadyTraderGoError("information ring size " + std::to_string(settings.mRingSize)
+                                 + " must be a power of two holding at least two frames");
+    }
+
+    return std::make_shared<Subscription>(mContext, mName, region, settings);
 }
 
 }
\ No newline at end of file
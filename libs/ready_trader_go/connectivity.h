@@ -18,6 +18,7 @@
 #ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_CONNECTIVITY_H
 #define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_CONNECTIVITY_H
 
+#include <array>
 #include <cstddef>
 #include <memory>
 #include <string>
@@ -25,31 +26,40 @@
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/tcp.hpp>
-#include <boost/asio/streambuf.hpp>
-#include <boost/interprocess/file_mapping.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/interprocess/mapped_region.hpp>
 #include <boost/system/error_code.hpp>
 
+#include "buffers.h"
 #include "connectivitytypes.h"
+#include "handlermemory.h"
 
 namespace interprocess = boost::interprocess;
 using boost::asio::ip::tcp;
 
 namespace ReadyTraderGo {
 
-// Each message begins with a two-part header:
-//   1. length - a two-byte, big endian, unsigned integer; and
-//   2. type - a one-byte unsigned integer.
-constexpr std::size_t MESSAGE_HEADER_SIZE = 3;
-constexpr std::size_t MESSAGE_TYPE_OFFSET = 2;
+// The largest message the two-byte length field can describe.
+constexpr std::size_t MAXIMUM_MESSAGE_SIZE = 65535;
+
+// Size of the execution connection's receive buffer. Reads always have room
+// for at least one maximum sized message.
+constexpr std::size_t RECEIVE_BUFFER_SIZE = 4 * MAXIMUM_MESSAGE_SIZE;
+
+// Size of the execution connection's send buffer.
+constexpr std::size_t SEND_BUFFER_SIZE = 4 * MAXIMUM_MESSAGE_SIZE;
 
 // Each subscription transport frame begins with a two-part header:
-//    1. spinlock - a four-byte little-endian flag (either 0 or 1); and
+//    1. status - a four-byte, big endian, unsigned integer whose top byte is
+//       a spinlock (either 0 or 1) and whose lower three bytes are the
+//       publisher's count of frames written, modulo 2^24; and
 //    2. payload size - a four-byte, big endian, unsigned intteger.
+// Frames are always FRAME_SIZE bytes and the ring of frames always fills the
+// whole of the mapped file, as that is how the exchange publishes them.
 constexpr std::size_t FRAME_PAYLOAD_SIZE_OFFSET = 4;
 constexpr std::size_t FRAME_HEADER_SIZE = 8;
+constexpr unsigned long FRAME_NUMBER_MASK = 0xFFFFFF;
 constexpr std::size_t FRAME_SIZE = 128;
-constexpr std::size_t SUBSCRIPTION_TRANSPORT_BUFFER_SIZE = 8182;
 
 
 class Connection : public IConnection
@@ -58,39 +68,94 @@ public:
     Connection(boost::asio::io_context& context, tcp::socket&& socket);
     ~Connection() override;
     void AsyncRead() override;
+    void Flush() override;
+    void SendFrame(unsigned char const* frame, std::size_t size, SendMode mode) override;
     void SendMessage(unsigned char messageType, const ISerialisable& serialisable, SendMode mode) override;
+    using IConnection::SendMessage;
 
 private:
     void Send();
     void Send(SendMode mode);
+    void QueueMessage(std::size_t size, SendMode mode);
+    void Write();
 
     void ReadSomeHandler(const boost::system::error_code& error, std::size_t size);
     void WriteSomeHandler(const boost::system::error_code& error, std::size_t size);
 
     boost::asio::io_context& mContext;
-    boost::asio::streambuf mInBuffer;
-    boost::asio::streambuf mOutBuffer;
-    bool mIsSending = false;
+    ReceiveBuffer mInBuffer;
+    SendBuffer mOutBuffer;
     bool mIsSendPosted = false;
     tcp::socket mSocket;
+
+    // One for each kind of operation, of which at most one is ever pending.
+    HandlerMemory mReadMemory;
+    HandlerMemory mWriteMemory;
+    HandlerMemory mSendMemory;
+};
+
+// Tracks the per-instrument sequence numbers of order book and trade ticks
+// messages so that missed or out-of-order messages can be detected.
+class SequenceTracker
+{
+public:
+    // Return false if the given message body does not follow on from the
+    // previous message with the same type and instrument, in which case
+    // expected and received are set to the relevant sequence numbers. Trade
+    // ticks must follow on exactly; order books need only move forward.
+    bool Check(unsigned char messageType,
+               unsigned char const* data,
+               std::size_t size,
+               unsigned long& expected,
+               unsigned long& received);
+
+private:
+    std::array<std::array<unsigned long, 2>, 2> mLastSequence = {};
 };
 
-class Subscription : public ISubscription
+// The parts common to subscriptions whose transport carries exactly one
+// message per frame or datagram.
+class MessageSubscription : public ISubscription
+{
+protected:
+    // Check a message's length and sequence number and deliver it.
+    void ReceiveFromHandler(unsigned char const* data, std::size_t size);
+
+private:
+    SequenceTracker mSequenceTracker;
+};
+
+class Subscription : public MessageSubscription
 {
 public:
     Subscription(boost::asio::io_context& context,
-                 interprocess::file_mapping& file,
-                 interprocess::mapped_region& region);
+                 const std::string& name,
+                 interprocess::mapped_region& region,
+                 const SubscriptionSettings& settings);
     ~Subscription() override;
     void AsyncReceive() override;
+    std::size_t Poll() override;
 
 private:
-    void AsyncReceive(unsigned long, std::weak_ptr<ISubscription>);
-    void ReceiveFromHandler(unsigned char const*, std::size_t size);
+    void AsyncReceive(std::weak_ptr<ISubscription>);
+    void Backoff(std::weak_ptr<ISubscription>);
+    void PostReceive(std::weak_ptr<ISubscription>);
+    std::size_t Deliver();
+    unsigned long Resynchronise(unsigned long pos);
+
+    unsigned long NextFrame(unsigned long pos) const { return (pos + FRAME_SIZE) & mRingMask; }
 
     boost::asio::io_context& mContext;
-    interprocess::file_mapping mFile;
     interprocess::mapped_region mRegion;
+    SubscriptionSettings mSettings;
+    unsigned long mRingMask;
+    boost::asio::steady_timer mTimer;
+    unsigned long mPosition = 0;
+    unsigned long mFrameNumber = 0; // expected at mPosition
+    bool mHasReceived = false;
+
+    // For the posted handler or timer wait that continues receiving.
+    HandlerMemory mReceiveMemory;
 };
 
 class ConnectionFactory : public IConnectionFactory
@@ -98,15 +163,20 @@ class ConnectionFactory : public IConnectionFactory
 public:
     ConnectionFactory(boost::asio::io_context& context,
                       std::string host,
-                      unsigned short port);
+                      unsigned short port,
+                      unsigned int busyPoll = 0);
 
     std::unique_ptr<IConnection> Create() override;
 
-private:
+protected:
+    // Return a non-blocking socket connected to the exchange.
+    tcp::socket Connect();
+
     boost::asio::io_context& mContext;
     std::vector<tcp::endpoint> mEndpoints;
     std::string mHost;
     unsigned short mPort;
+    unsigned int mBusyPoll; // SO_BUSY_POLL in microseconds, or zero
 };
 
 class SubscriptionFactory : public ISubscriptionFactory
@@ -114,14 +184,19 @@ class SubscriptionFactory : public ISubscriptionFactory
 public:
     SubscriptionFactory(boost::asio::io_context& context,
                         const std::string& type,
-                        const std::string& name);
+                        const std::string& name,
+                        const SubscriptionSettings& settings);
 
     std::shared_ptr<ISubscription> Create() override;
 
 private:
+    interprocess::mapped_region Map() const;
+    void Prepare(interprocess::mapped_region& region) const;
+
     boost::asio::io_context& mContext;
     std::string mType;
     std::string mName;
+    SubscriptionSettings mSettings;
 };
 
 }
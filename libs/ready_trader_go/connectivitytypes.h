@@ -18,11 +18,15 @@
 #ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_CONNECTIVITYTYPES_H
 #define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_CONNECTIVITYTYPES_H
 
+#include <chrono>
 #include <cstddef>
 #include <functional>
 #include <memory>
+#include <string>
 #include <utility>
 
+#include "codec.h"
+
 namespace ReadyTraderGo {
 
 enum class SendMode
@@ -31,6 +35,75 @@ enum class SendMode
     SOON
 };
 
+// What a subscription does once it has spun for SpinCount empty polls:
+//   SPIN - hand control back to the io_context and resume spinning;
+//   YIELD - yield the processor to other threads, then resume; or
+//   SLEEP - wait on a timer for SleepInterval before polling again.
+enum class PollPolicy : unsigned char
+{
+    SPIN,
+    YIELD,
+    SLEEP
+};
+
+struct SubscriptionSettings
+{
+    std::size_t mRingSize = 0; // zero, or else the size of the mapping
+    PollPolicy mPollPolicy = PollPolicy::SPIN;
+    unsigned long mSpinCount = 100;
+    std::chrono::microseconds mSleepInterval{50};
+    unsigned long mMaxBatch = 64;
+
+    // Set when the application's run loop calls Poll directly, in which
+    // case AsyncReceive does nothing.
+    bool mIsPolledExternally = false;
+
+    // Used by the mmap and shm transports only.
+    bool mPrefault = true;
+    bool mLock = false;
+    bool mHugePages = false;
+
+    // Used by the UDP transport only.
+    std::size_t mReceiveBufferSize = 0; // zero leaves the system default
+    std::string mInterface; // local address on which to join a multicast group
+    bool mTimestamps = true;
+};
+
+// Settings for the io_uring execution transport. Both counts must be
+// powers of two.
+struct UringSettings
+{
+    unsigned int mEntries = 64;
+    bool mSqPoll = false;
+    unsigned int mSqPollIdle = 10; // milliseconds
+    unsigned int mReceiveBufferCount = 16;
+    std::size_t mReceiveBufferSize = 4096;
+};
+
+struct SubscriptionStatistics
+{
+    unsigned long mFramesReceived = 0;
+    unsigned long mBatches = 0;
+    unsigned long mEmptyPolls = 0;
+    unsigned long mBackoffs = 0;
+    unsigned long mOverruns = 0;
+    unsigned long mFramesSkipped = 0;
+    unsigned long mSequenceGaps = 0;
+    unsigned long mMessagesMissed = 0;
+    unsigned long mTruncated = 0;
+};
+
+struct ConnectionStatistics
+{
+    unsigned long mMessagesSent = 0;
+    unsigned long mBytesSent = 0;
+    unsigned long mFlushes = 0;
+    unsigned long mInlineWrites = 0; // accepted at least one byte
+    unsigned long mBlockedWrites = 0; // accepted nothing
+    unsigned long mAsyncWrites = 0;
+    std::size_t mMaxPending = 0;
+};
+
 struct ISerialisable
 {
     virtual std::size_t Size() const noexcept = 0;
@@ -50,6 +123,44 @@ struct IConnection
         SendMessage(messageType, serialisable, SendMode::ASAP);
     }
 
+    // Send a message described by MessageTraits<M>. The message is encoded
+    // inline, so the only virtual call is the one that hands the finished
+    // frame to the transport.
+    template<typename M>
+    void SendMessage(const M& message, SendMode mode = SendMode::ASAP)
+    {
+        unsigned char frame[messageSize<M>()];
+        encodeMessage(message, frame);
+        SendFrame(frame, sizeof(frame), mode);
+    }
+
+    template<typename M>
+    void SendMessage(const MessageTemplate<M>& message, SendMode mode = SendMode::ASAP)
+    {
+        SendFrame(message.GetData(), message.GetSize(), mode);
+    }
+
+    // Send a complete, already encoded message (or several back to back).
+    virtual void SendFrame(unsigned char const* frame, std::size_t size, SendMode mode) = 0;
+
+    // Between BeginBatch and the matching EndBatch messages are queued but
+    // not written, so that they leave together in as few writes as
+    // possible when the outermost batch ends. Batches may be nested.
+    void BeginBatch() { ++mBatchDepth; }
+    void EndBatch()
+    {
+        if (--mBatchDepth == 0)
+        {
+            Flush();
+        }
+    }
+    bool IsBatching() const { return mBatchDepth != 0; }
+
+    // Start writing any queued messages now.
+    virtual void Flush() = 0;
+
+    const ConnectionStatistics& GetStatistics() const { return mStatistics; }
+
     const std::string& GetName() const { return mName; }
     void SetName(std::string name) { mName = std::move(name); }
 
@@ -73,7 +184,50 @@ protected:
         }
     }
 
+    static constexpr std::size_t INVALID_MESSAGE = static_cast<std::size_t>(-1);
+
+    // Pass each complete message at the start of data to OnMessageReceipt
+    // and return the number of bytes used, or INVALID_MESSAGE if a message
+    // header holds an impossible length.
+    std::size_t DeliverMessages(unsigned char const* data, std::size_t size)
+    {
+        auto* upto = data;
+        while (size >= MESSAGE_HEADER_SIZE)
+        {
+            const std::size_t messageLength = boost::endian::big_to_native(*(uint16_t*)upto);
+            if (messageLength < MESSAGE_HEADER_SIZE)
+                return INVALID_MESSAGE;
+            if (size < messageLength)
+                break;
+
+            OnMessageReceipt(upto[MESSAGE_TYPE_OFFSET], upto + MESSAGE_HEADER_SIZE, messageLength - MESSAGE_HEADER_SIZE);
+            upto += messageLength;
+            size -= messageLength;
+        }
+        return upto - data;
+    }
+
     std::string mName;
+    ConnectionStatistics mStatistics;
+
+private:
+    unsigned int mBatchDepth = 0;
+};
+
+// Groups the messages sent during its lifetime into a single batch on
+// anything with BeginBatch and EndBatch functions.
+template<typename T>
+class SendBatch
+{
+public:
+    explicit SendBatch(T& target) : mTarget(target) { mTarget.BeginBatch(); }
+    ~SendBatch() { mTarget.EndBatch(); }
+
+    SendBatch(const SendBatch&) = delete;
+    SendBatch& operator=(const SendBatch&) = delete;
+
+private:
+    T& mTarget;
 };
 
 struct ISubscription: public std::enable_shared_from_this<ISubscription>
@@ -81,12 +235,30 @@ struct ISubscription: public std::enable_shared_from_this<ISubscription>
     virtual ~ISubscription() = default;
     virtual void AsyncReceive() = 0;
 
+    // Deliver whatever has already arrived, without waiting, and return the
+    // number of frames or datagrams delivered.
+    virtual std::size_t Poll() = 0;
+
     const std::string& GetName() const { return mName; }
     void SetName(std::string name) { mName = std::move(name); }
 
+    const SubscriptionStatistics& GetStatistics() const { return mStatistics; }
+
+    // Called if the subscription fails and will deliver nothing more.
+    std::function<void(ISubscription*)> Disconnected;
     std::function<void(ISubscription*, unsigned char, unsigned char const*, std::size_t)> MessageReceived;
+    std::function<void(ISubscription*, std::size_t)> Overrun;
+    std::function<void(ISubscription*, unsigned char, unsigned char, unsigned long, unsigned long)> SequenceGap;
 
 protected:
+    void OnDisconnect()
+    {
+        if (Disconnected)
+        {
+            Disconnected(this);
+        }
+    }
+
     void OnMessageReceipt(unsigned char messageType, unsigned char const* data, std::size_t size)
     {
         if (MessageReceived)
@@ -95,7 +267,27 @@ protected:
         }
     }
 
+    void OnOverrun(std::size_t framesSkipped)
+    {
+        if (Overrun)
+        {
+            Overrun(this, framesSkipped);
+        }
+    }
+
+    void OnSequenceGap(unsigned char messageType,
+                       unsigned char instrument,
+                       unsigned long expected,
+                       unsigned long received)
+    {
+        if (SequenceGap)
+        {
+            SequenceGap(this, messageType, instrument, expected, received);
+        }
+    }
+
     std::string mName;
+    SubscriptionStatistics mStatistics;
 };
 
 struct IConnectionFactory
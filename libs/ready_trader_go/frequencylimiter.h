@@ -0,0 +1,112 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_FREQUENCYLIMITER_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_FREQUENCYLIMITER_H
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+
+#include "error.h"
+
+namespace ReadyTraderGo {
+
+// Counts events in a rolling time interval, like the exchange's
+// FrequencyLimiter, but without ever queueing or freeing anything.
+//
+// The times of the last limit events are kept in a ring. The slot the
+// next event will overwrite holds the oldest of them, so an event is
+// allowed exactly when that oldest event has left the interval.
+class FrequencyLimiter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    FrequencyLimiter(Clock::duration interval, std::size_t limit);
+
+    FrequencyLimiter(const FrequencyLimiter&) = delete;
+    FrequencyLimiter& operator=(const FrequencyLimiter&) = delete;
+    FrequencyLimiter(FrequencyLimiter&&) = default;
+    FrequencyLimiter& operator=(FrequencyLimiter&&) = default;
+
+    // True if an event at now would not breach the limit.
+    bool IsAvailable(Clock::time_point now) const { return mTimes[mNext] + mInterval <= now; }
+
+    // The number of events that may happen at now.
+    std::size_t GetAvailable(Clock::time_point now) const;
+
+    // The time at which the next event will be allowed.
+    Clock::time_point GetNextAvailableTime() const { return mTimes[mNext] + mInterval; }
+
+    void Record(Clock::time_point now)
+    {
+        mTimes[mNext] = now;
+        mNext = (mNext + 1 == mLimit) ? 0 : mNext + 1;
+    }
+
+    // Record an event at now if it would not breach the limit.
+    bool TryRecord(Clock::time_point now)
+    {
+        if (!IsAvailable(now))
+        {
+            return false;
+        }
+        Record(now);
+        return true;
+    }
+
+    Clock::duration GetInterval() const { return mInterval; }
+    std::size_t GetLimit() const { return mLimit; }
+
+private:
+    Clock::duration mInterval;
+    std::size_t mLimit;
+    std::size_t mNext = 0;
+    std::unique_ptr<Clock::time_point[]> mTimes;
+};
+
+inline FrequencyLimiter::FrequencyLimiter(Clock::duration interval, std::size_t limit)
+    : mInterval(interval), mLimit(limit), mTimes(new Clock::time_point[limit])
+{
+    if (limit == 0)
+    {
+        throw ReadyTraderGoError("frequency limit must be at least one");
+    }
+    for (std::size_t i = 0; i != limit; ++i)
+    {
+        mTimes[i] = Clock::time_point::min();
+    }
+}
+
+inline std::size_t FrequencyLimiter::GetAvailable(Clock::time_point now) const
+{
+    // The ring holds times oldest first from mNext, so count until one is
+    // still inside the interval.
+    std::size_t count = 0;
+    std::size_t i = mNext;
+    while (count != mLimit && mTimes[i] + mInterval <= now)
+    {
+        ++count;
+        i = (i + 1 == mLimit) ? 0 : i + 1;
+    }
+    return count;
+}
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_FREQUENCYLIMITER_H
@@ -0,0 +1,135 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_HANDLERMEMORY_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_HANDLERMEMORY_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "buffers.h"
+
+namespace ReadyTraderGo {
+
+constexpr std::size_t HANDLER_MEMORY_SIZE = 256;
+
+// Memory for the handler of one asynchronous operation at a time.
+//
+// Asio frees an operation's memory before calling its handler, so a chain
+// of operations in which each handler starts the next (a read loop, or a
+// handler that reposts itself) can reuse the same block indefinitely. An
+// allocation that doesn't fit, or that overlaps one still in use, falls
+// back to the heap and is counted, so a non-zero heap count shows that a
+// block is too small or shared by concurrent operations.
+class HandlerMemory
+{
+public:
+    HandlerMemory() = default;
+
+    HandlerMemory(const HandlerMemory&) = delete;
+    HandlerMemory& operator=(const HandlerMemory&) = delete;
+
+    void* Allocate(std::size_t size)
+    {
+        if (!mIsInUse && size <= sizeof(mStorage))
+        {
+            mIsInUse = true;
+            ++mAllocations;
+            return mStorage;
+        }
+        ++mHeapAllocations;
+        return ::operator new(size);
+    }
+
+    void Deallocate(void* pointer)
+    {
+        if (pointer == mStorage)
+        {
+            mIsInUse = false;
+        }
+        else
+        {
+            ::operator delete(pointer);
+        }
+    }
+
+    unsigned long GetAllocations() const { return mAllocations; }
+    unsigned long GetHeapAllocations() const { return mHeapAllocations; }
+
+private:
+    alignas(CACHE_LINE_SIZE) unsigned char mStorage[HANDLER_MEMORY_SIZE];
+    bool mIsInUse = false;
+    unsigned long mAllocations = 0;
+    unsigned long mHeapAllocations = 0;
+};
+
+// The allocator associated with handlers wrapped by makeAllocatingHandler.
+template<typename T>
+class HandlerAllocator
+{
+public:
+    using value_type = T;
+
+    explicit HandlerAllocator(HandlerMemory& memory) : mMemory(memory) {}
+
+    template<typename U>
+    HandlerAllocator(const HandlerAllocator<U>& other) noexcept : mMemory(other.mMemory) {}
+
+    T* allocate(std::size_t n) const { return static_cast<T*>(mMemory.Allocate(sizeof(T) * n)); }
+    void deallocate(T* pointer, std::size_t) const { mMemory.Deallocate(pointer); }
+
+    template<typename U>
+    bool operator==(const HandlerAllocator<U>& other) const noexcept { return &mMemory == &other.mMemory; }
+    template<typename U>
+    bool operator!=(const HandlerAllocator<U>& other) const noexcept { return &mMemory != &other.mMemory; }
+
+private:
+    template<typename> friend class HandlerAllocator;
+
+    HandlerMemory& mMemory;
+};
+
+// A completion handler whose associated allocator draws on a HandlerMemory.
+template<typename Handler>
+class AllocatingHandler
+{
+public:
+    using allocator_type = HandlerAllocator<Handler>;
+
+    AllocatingHandler(HandlerMemory& memory, Handler handler) : mMemory(memory), mHandler(std::move(handler)) {}
+
+    allocator_type get_allocator() const noexcept { return allocator_type(mMemory); }
+
+    template<typename... Args>
+    void operator()(Args&&... args) { mHandler(std::forward<Args>(args)...); }
+
+private:
+    HandlerMemory& mMemory;
+    Handler mHandler;
+};
+
+template<typename Handler>
+inline AllocatingHandler<std::decay_t<Handler>> makeAllocatingHandler(HandlerMemory& memory, Handler&& handler)
+{
+    return AllocatingHandler<std::decay_t<Handler>>(memory, std::forward<Handler>(handler));
+}
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_HANDLERMEMORY_H
@@ -0,0 +1,138 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_MPSCQUEUE_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_MPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "buffers.h"
+#include "error.h"
+
+namespace ReadyTraderGo {
+
+// A bounded, lock-free queue for any number of producer threads and a
+// single consumer thread.
+//
+// Each slot carries a sequence number saying whose turn it is: producers
+// claim a slot by advancing the shared tail with a compare-and-swap and
+// publish it by bumping the slot's sequence, and the consumer releases it
+// by bumping the sequence again, a whole lap ahead. Neither side ever
+// waits for the other or allocates; a push onto a full queue simply
+// fails. The capacity must be a power of two.
+template<typename T>
+class MpscQueue
+{
+public:
+    explicit MpscQueue(std::size_t capacity);
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Any thread: copy value into the queue, or return false if it is full.
+    bool TryPush(const T& value);
+
+    // Consumer: move the oldest value into value, or return false if there
+    // is none (or the oldest producer has not yet finished writing it).
+    bool TryPop(T& value);
+
+    // Consumer: true if TryPop would fail.
+    bool IsEmpty() const
+    {
+        return mSlots[mHead & mMask].mSequence.load(std::memory_order_acquire) != mHead + 1;
+    }
+
+    std::size_t GetCapacity() const { return mCapacity; }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Slot
+    {
+        std::atomic<std::size_t> mSequence;
+        T mValue;
+    };
+
+    std::size_t mCapacity;
+    std::size_t mMask;
+    std::unique_ptr<Slot[]> mSlots;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mTail{0};
+    alignas(CACHE_LINE_SIZE) std::size_t mHead = 0;
+};
+
+template<typename T>
+MpscQueue<T>::MpscQueue(std::size_t capacity)
+    : mCapacity(capacity), mMask(capacity - 1), mSlots(new Slot[capacity])
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+    {
+        throw ReadyTraderGoError("queue capacity " + std::to_string(capacity) + " is not a power of two");
+    }
+    for (std::size_t i = 0; i != capacity; ++i)
+    {
+        mSlots[i].mSequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template<typename T>
+bool MpscQueue<T>::TryPush(const T& value)
+{
+    std::size_t tail = mTail.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Slot& slot = mSlots[tail & mMask];
+        const std::size_t sequence = slot.mSequence.load(std::memory_order_acquire);
+        const auto lag = static_cast<std::ptrdiff_t>(sequence - tail);
+        if (lag == 0)
+        {
+            if (mTail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+            {
+                slot.mValue = value;
+                slot.mSequence.store(tail + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (lag < 0)
+        {
+            return false;
+        }
+        else
+        {
+            tail = mTail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template<typename T>
+bool MpscQueue<T>::TryPop(T& value)
+{
+    Slot& slot = mSlots[mHead & mMask];
+    if (slot.mSequence.load(std::memory_order_acquire) != mHead + 1)
+    {
+        return false;
+    }
+    value = std::move(slot.mValue);
+    slot.mSequence.store(mHead + mCapacity, std::memory_order_release);
+    ++mHead;
+    return true;
+}
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_MPSCQUEUE_H
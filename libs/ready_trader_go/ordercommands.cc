@@ -0,0 +1,137 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <boost/asio/post.hpp>
+
+#ifdef RTG_HAVE_EVENTFD
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#include "error.h"
+#include "logging.h"
+#include "ordercommands.h"
+
+RTG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_CMD, "COMMANDS")
+
+namespace ReadyTraderGo {
+
+#ifdef RTG_HAVE_EVENTFD
+static int createEventFd()
+{
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd == -1)
+    {
+        throw ReadyTraderGoError(std::string("unable to create order command eventfd: ") + std::strerror(errno));
+    }
+    return fd;
+}
+#endif
+
+OrderCommandQueue::OrderCommandQueue(boost::asio::io_context& context,
+                                     std::size_t capacity,
+                                     bool isPolledExternally)
+    : mContext(context),
+      mQueue(capacity),
+      mIsPolledExternally(isPolledExternally)
+#ifdef RTG_HAVE_EVENTFD
+      , mWakeup(context, createEventFd())
+#endif
+{
+}
+
+OrderCommandQueue::~OrderCommandQueue()
+{
+    RLOG(LG_CMD, LogLevel::LL_INFO) << "order command queue closing: drained=" << mDrained << " rejected="
+                                    << mRejected.load(std::memory_order_relaxed) << " wakeups=" << mWakeups
+                                    << " handler_allocations=" << mWakeupMemory.GetAllocations()
+                                    << " heap_allocations=" << mWakeupMemory.GetHeapAllocations();
+}
+
+bool OrderCommandQueue::Submit(const OrderCommand& command)
+{
+    if (!mQueue.TryPush(command))
+    {
+        mRejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (mIsPolledExternally || mIsWakeupPending.exchange(true))
+    {
+        return true;
+    }
+
+#ifdef RTG_HAVE_EVENTFD
+    const uint64_t one = 1;
+    // The eventfd is non-blocking and its counter cannot realistically
+    // overflow, so the only possible failure is harmless.
+    [[maybe_unused]] auto written = ::write(mWakeup.native_handle(), &one, sizeof(one));
+#else
+    // Without an eventfd the wakeup has to be posted, which allocates.
+    boost::asio::post(mContext, [this] { WakeupHandler({}); });
+#endif
+    return true;
+}
+
+void OrderCommandQueue::AsyncWait()
+{
+#ifdef RTG_HAVE_EVENTFD
+    if (!mIsPolledExternally)
+    {
+        mWakeup.async_wait(boost::asio::posix::stream_descriptor::wait_read,
+                           makeAllocatingHandler(mWakeupMemory, [this](auto& error) { WakeupHandler(error); }));
+    }
+#endif
+}
+
+void OrderCommandQueue::WakeupHandler(const boost::system::error_code& error)
+{
+    if (error)
+    {
+        if (error != boost::asio::error::operation_aborted)
+        {
+            RLOG(LG_CMD, LogLevel::LL_ERROR) << "order command wakeup failed: " << error.message();
+        }
+        return;
+    }
+
+    ++mWakeups;
+
+#ifdef RTG_HAVE_EVENTFD
+    uint64_t count;
+    [[maybe_unused]] auto bytesRead = ::read(mWakeup.native_handle(), &count, sizeof(count));
+#endif
+
+    // Clear the flag before draining, so that a command submitted after
+    // the drain has looked at the queue always brings another wakeup.
+    mIsWakeupPending.store(false);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (CommandsReady)
+    {
+        CommandsReady();
+    }
+
+    AsyncWait();
+}
+
+}
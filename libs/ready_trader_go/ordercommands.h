@@ -0,0 +1,129 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_ORDERCOMMANDS_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_ORDERCOMMANDS_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/system/error_code.hpp>
+
+#if defined(__linux__)
+#include <boost/asio/posix/stream_descriptor.hpp>
+#define RTG_HAVE_EVENTFD 1
+#endif
+
+#include "handlermemory.h"
+#include "mpscqueue.h"
+#include "types.h"
+
+namespace ReadyTraderGo {
+
+constexpr std::size_t DEFAULT_ORDER_COMMAND_QUEUE_CAPACITY = 1024;
+
+enum class OrderCommandType : unsigned char
+{
+    INSERT,
+    AMEND,
+    CANCEL,
+    HEDGE
+};
+
+// An order operation submitted from outside the io_context thread. Only
+// the fields that apply to its type are used. A submitted insert or hedge
+// carries the submitter's key in place of a client order id, as only the
+// io_context thread can choose the id.
+struct OrderCommand
+{
+    OrderCommandType mType;
+    Side mSide;
+    Lifespan mLifespan;
+    unsigned long mClientOrderId;
+    unsigned long mPrice;
+    unsigned long mVolume;
+};
+
+// Carries order commands from any number of threads to the io_context
+// thread, where they are sent like any other order.
+//
+// Submit never blocks or allocates: the command is copied into an
+// MpscQueue, and if the consumer is not already due to run, an eventfd
+// the io_context is watching is written to wake it. When the application
+// is busy polling, the run loop drains the queue directly instead and no
+// wakeup is needed.
+class OrderCommandQueue
+{
+public:
+    OrderCommandQueue(boost::asio::io_context& context, std::size_t capacity, bool isPolledExternally);
+    ~OrderCommandQueue();
+
+    OrderCommandQueue(const OrderCommandQueue&) = delete;
+    OrderCommandQueue& operator=(const OrderCommandQueue&) = delete;
+
+    // Any thread: queue a command, or return false if the queue is full.
+    bool Submit(const OrderCommand& command);
+
+    // io_context thread: start calling CommandsReady whenever commands
+    // have been submitted.
+    void AsyncWait();
+
+    // io_context thread: pass each queued command to handler and return
+    // the count.
+    template<typename F>
+    std::size_t Drain(F&& handler);
+    bool IsEmpty() const { return mQueue.IsEmpty(); }
+
+    std::function<void()> CommandsReady;
+
+private:
+    void WakeupHandler(const boost::system::error_code& error);
+
+    boost::asio::io_context& mContext;
+    MpscQueue<OrderCommand> mQueue;
+    bool mIsPolledExternally;
+
+#ifdef RTG_HAVE_EVENTFD
+    boost::asio::posix::stream_descriptor mWakeup;
+#endif
+    std::atomic<bool> mIsWakeupPending{false};
+    HandlerMemory mWakeupMemory;
+
+    std::atomic<unsigned long> mRejected{0};
+    unsigned long mDrained = 0;
+    unsigned long mWakeups = 0;
+};
+
+template<typename F>
+std::size_t OrderCommandQueue::Drain(F&& handler)
+{
+    std::size_t count = 0;
+    OrderCommand command;
+    while (mQueue.TryPop(command))
+    {
+        handler(command);
+        ++count;
+    }
+    mDrained += count;
+    return count;
+}
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_ORDERCOMMANDS_H
@@ -0,0 +1,300 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_ORDERMANAGER_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_ORDERMANAGER_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "error.h"
+#include "types.h"
+
+namespace ReadyTraderGo {
+
+constexpr std::size_t DEFAULT_ORDER_MANAGER_CAPACITY = 1024;
+
+enum class OrderStatus : unsigned char
+{
+    NONE,
+    LIVE,
+    DONE
+};
+
+// The state of one of our orders, as last reported by the exchange.
+struct Order
+{
+    unsigned long mClientOrderId = 0;
+    unsigned long mPrice = 0;
+    unsigned long mVolume = 0;
+    unsigned long mRemainingVolume = 0;
+    unsigned long mFillVolume = 0;
+    signed long mFees = 0;
+    Side mSide = Side::SELL;
+    Lifespan mLifespan = Lifespan::FILL_AND_KILL;
+    bool mIsHedge = false;
+    OrderStatus mStatus = OrderStatus::NONE;
+    bool mIsAcknowledged = false; // a fill or order status has arrived
+};
+
+// Tracks our orders in a flat array of slots indexed by client order id.
+//
+// Client order ids only ever increase, so the home slot for an id is
+// simply the id modulo the capacity, and finding an order is usually one
+// index and one comparison. An order holds its slot while it is live and
+// gives it up when the exchange reports it done (or rejects it), after
+// which it can still be read until a later id lands on the same slot. If
+// an order that has stayed live for a whole capacity of ids still holds
+// the home slot, the new order takes the next free slot instead, and
+// lookups search as many slots past the home slot as any order has ever
+// been displaced. Nothing is allocated after construction, however long
+// the session. The capacity must be a power of two.
+//
+// The Apply functions take the arguments of the corresponding
+// BaseAutoTrader handlers and return the updated order, or nullptr if the
+// id does not belong to an order that is being tracked. An error only
+// ends an order the exchange hasn't yet acknowledged: one about an order
+// that is already in the book (e.g. a refused amend) leaves it live.
+class OrderManager
+{
+public:
+    explicit OrderManager(std::size_t capacity = DEFAULT_ORDER_MANAGER_CAPACITY);
+
+    OrderManager(const OrderManager&) = delete;
+    OrderManager& operator=(const OrderManager&) = delete;
+
+    // Start tracking an order as it is sent, or return nullptr if every
+    // slot is held by a live order.
+    Order* Insert(unsigned long clientOrderId,
+                  Side side,
+                  unsigned long price,
+                  unsigned long volume,
+                  Lifespan lifespan);
+    Order* Hedge(unsigned long clientOrderId, Side side, unsigned long price, unsigned long volume);
+
+    const Order* ApplyError(unsigned long clientOrderId);
+    const Order* ApplyHedgeFilled(unsigned long clientOrderId, unsigned long price, unsigned long volume);
+    const Order* ApplyOrderFilled(unsigned long clientOrderId, unsigned long price, unsigned long volume);
+    const Order* ApplyOrderStatus(unsigned long clientOrderId,
+                                  unsigned long fillVolume,
+                                  unsigned long remainingVolume,
+                                  signed long fees);
+
+    // Return the order with the given id, live or done, if it still has a slot.
+    const Order* Find(unsigned long clientOrderId) const;
+    bool IsLive(unsigned long clientOrderId) const;
+
+    // The number of live (non-hedge) orders and their total remaining
+    // volume on each side.
+    std::size_t GetActiveCount() const { return mActiveCount; }
+    unsigned long GetActiveVolume(Side side) const { return mActiveVolume[static_cast<std::size_t>(side)]; }
+    unsigned long GetActiveVolume() const { return mActiveVolume[0] + mActiveVolume[1]; }
+
+    std::size_t GetCapacity() const { return mCapacity; }
+
+private:
+    Order* Track(unsigned long clientOrderId, Side side, unsigned long price, unsigned long volume);
+    Order* FindLive(unsigned long clientOrderId);
+    Order* FindSlot(unsigned long clientOrderId) const;
+    void SetRemainingVolume(Order& order, unsigned long remainingVolume);
+    void Release(Order& order);
+
+    std::size_t mCapacity;
+    std::size_t mMask;
+    std::unique_ptr<Order[]> mOrders;
+    std::size_t mMaxDisplacement = 0;
+
+    std::size_t mActiveCount = 0;
+    std::array<unsigned long, 2> mActiveVolume{};
+};
+
+inline OrderManager::OrderManager(std::size_t capacity)
+    : mCapacity(capacity), mMask(capacity - 1), mOrders(new Order[capacity])
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+    {
+        throw ReadyTraderGoError("order manager capacity " + std::to_string(capacity) + " is not a power of two");
+    }
+}
+
+inline Order* OrderManager::Track(unsigned long clientOrderId, Side side, unsigned long price, unsigned long volume)
+{
+    for (std::size_t displacement = 0; displacement != mCapacity; ++displacement)
+    {
+        Order& order = mOrders[(clientOrderId + displacement) & mMask];
+        if (order.mStatus != OrderStatus::LIVE)
+        {
+            order = Order{clientOrderId, price, volume, volume, 0, 0, side};
+            order.mStatus = OrderStatus::LIVE;
+            if (displacement > mMaxDisplacement)
+            {
+                mMaxDisplacement = displacement;
+            }
+            return &order;
+        }
+    }
+    return nullptr;
+}
+
+inline Order* OrderManager::Insert(unsigned long clientOrderId,
+                                   Side side,
+                                   unsigned long price,
+                                   unsigned long volume,
+                                   Lifespan lifespan)
+{
+    Order* order = Track(clientOrderId, side, price, volume);
+    if (order)
+    {
+        order->mLifespan = lifespan;
+        ++mActiveCount;
+        mActiveVolume[static_cast<std::size_t>(side)] += volume;
+    }
+    return order;
+}
+
+inline Order* OrderManager::Hedge(unsigned long clientOrderId, Side side, unsigned long price, unsigned long volume)
+{
+    Order* order = Track(clientOrderId, side, price, volume);
+    if (order)
+    {
+        order->mIsHedge = true;
+    }
+    return order;
+}
+
+inline Order* OrderManager::FindSlot(unsigned long clientOrderId) const
+{
+    for (std::size_t displacement = 0; displacement <= mMaxDisplacement; ++displacement)
+    {
+        Order& order = mOrders[(clientOrderId + displacement) & mMask];
+        if (order.mClientOrderId == clientOrderId && order.mStatus != OrderStatus::NONE)
+        {
+            return &order;
+        }
+    }
+    return nullptr;
+}
+
+inline Order* OrderManager::FindLive(unsigned long clientOrderId)
+{
+    Order* order = FindSlot(clientOrderId);
+    return (order && order->mStatus == OrderStatus::LIVE) ? order : nullptr;
+}
+
+inline const Order* OrderManager::Find(unsigned long clientOrderId) const
+{
+    return FindSlot(clientOrderId);
+}
+
+inline bool OrderManager::IsLive(unsigned long clientOrderId) const
+{
+    const Order* order = FindSlot(clientOrderId);
+    return order && order->mStatus == OrderStatus::LIVE;
+}
+
+inline void OrderManager::SetRemainingVolume(Order& order, unsigned long remainingVolume)
+{
+    if (!order.mIsHedge)
+    {
+        mActiveVolume[static_cast<std::size_t>(order.mSide)] += remainingVolume - order.mRemainingVolume;
+    }
+    order.mRemainingVolume = remainingVolume;
+}
+
+inline void OrderManager::Release(Order& order)
+{
+    SetRemainingVolume(order, 0);
+    if (!order.mIsHedge)
+    {
+        --mActiveCount;
+    }
+    order.mStatus = OrderStatus::DONE;
+}
+
+inline const Order* OrderManager::ApplyError(unsigned long clientOrderId)
+{
+    Order* order = FindLive(clientOrderId);
+    if (order && !order->mIsAcknowledged)
+    {
+        Release(*order);
+        return order;
+    }
+    return nullptr;
+}
+
+inline const Order* OrderManager::ApplyHedgeFilled(unsigned long clientOrderId,
+                                                   unsigned long price,
+                                                   unsigned long volume)
+{
+    Order* order = FindLive(clientOrderId);
+    if (order)
+    {
+        order->mFillVolume = volume;
+        Release(*order);
+    }
+    return order;
+}
+
+inline const Order* OrderManager::ApplyOrderFilled(unsigned long clientOrderId,
+                                                   unsigned long price,
+                                                   unsigned long volume)
+{
+    // The order status that follows every fill settles the volumes; this
+    // just keeps them right in between.
+    Order* order = FindLive(clientOrderId);
+    if (order)
+    {
+        order->mIsAcknowledged = true;
+    }
+    if (order && volume <= order->mRemainingVolume)
+    {
+        order->mFillVolume += volume;
+        SetRemainingVolume(*order, order->mRemainingVolume - volume);
+    }
+    return order;
+}
+
+inline const Order* OrderManager::ApplyOrderStatus(unsigned long clientOrderId,
+                                                   unsigned long fillVolume,
+                                                   unsigned long remainingVolume,
+                                                   signed long fees)
+{
+    Order* order = FindLive(clientOrderId);
+    if (order)
+    {
+        order->mIsAcknowledged = true;
+        order->mFillVolume = fillVolume;
+        order->mFees = fees;
+        if (remainingVolume == 0)
+        {
+            Release(*order);
+        }
+        else
+        {
+            // An amend reduces the volume as well as the remaining volume.
+            order->mVolume = fillVolume + remainingVolume;
+            SetRemainingVolume(*order, remainingVolume);
+        }
+    }
+    return order;
+}
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_ORDERMANAGER_H
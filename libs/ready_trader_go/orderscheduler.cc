@@ -0,0 +1,269 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#include <string>
+
+#include <boost/asio/error.hpp>
+
+#include "error.h"
+#include "logging.h"
+#include "orderscheduler.h"
+
+RTG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_SCHED, "SCHEDULER")
+
+namespace ReadyTraderGo {
+
+OrderScheduler::Ring::Ring(std::size_t capacity)
+    : mCapacity(capacity), mMask(capacity - 1), mSlots(new Slot[capacity])
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+    {
+        throw ReadyTraderGoError("order scheduler capacity " + std::to_string(capacity) + " is not a power of two");
+    }
+}
+
+void OrderScheduler::Ring::SkipRemoved()
+{
+    while (mHead != mTail && mSlots[mHead & mMask].mIsRemoved)
+    {
+        ++mHead;
+    }
+}
+
+bool OrderScheduler::Ring::TryPop(ScheduledOrder& order)
+{
+    if (IsEmpty())
+    {
+        return false;
+    }
+    order = mSlots[mHead++ & mMask].mOrder;
+    SkipRemoved();
+    return true;
+}
+
+OrderScheduler::Ring::Slot* OrderScheduler::Ring::FindSlot(OrderCommandType type, unsigned long key)
+{
+    for (std::size_t i = mHead; i != mTail; ++i)
+    {
+        Slot& slot = mSlots[i & mMask];
+        if (!slot.mIsRemoved && slot.mOrder.mKey == key && slot.mOrder.mCommand.mType == type)
+        {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+ScheduledOrder* OrderScheduler::Ring::Find(OrderCommandType type, unsigned long key)
+{
+    Slot* slot = FindSlot(type, key);
+    return slot ? &slot->mOrder : nullptr;
+}
+
+bool OrderScheduler::Ring::Remove(OrderCommandType type, unsigned long key)
+{
+    Slot* slot = FindSlot(type, key);
+    if (!slot)
+    {
+        return false;
+    }
+    slot->mIsRemoved = true;
+    SkipRemoved();
+    return true;
+}
+
+OrderScheduler::OrderScheduler(boost::asio::io_context& context, std::size_t capacity)
+    : mUrgent(capacity), mInserts(capacity), mTimer(context)
+{
+}
+
+OrderScheduler::~OrderScheduler()
+{
+    RLOG(LG_SCHED, LogLevel::LL_INFO) << "order scheduler closing: scheduled=" << mScheduled << " coalesced="
+                                      << mCoalesced << " released=" << mReleased << " requeued=" << mRequeued
+                                      << " wakeups=" << mWakeups
+                                      << " handler_allocations=" << mTimerMemory.GetAllocations()
+                                      << " heap_allocations=" << mTimerMemory.GetHeapAllocations();
+}
+
+bool OrderScheduler::ScheduleAmend(unsigned long clientOrderId, unsigned long volume)
+{
+    ++mScheduled;
+    if (ScheduledOrder* waiting = mUrgent.Find(OrderCommandType::AMEND, clientOrderId))
+    {
+        waiting->mCommand.mVolume = volume;
+        ++mCoalesced;
+        return true;
+    }
+    if (mUrgent.Find(OrderCommandType::CANCEL, clientOrderId))
+    {
+        // Amending an order that is about to be cancelled achieves nothing.
+        ++mCoalesced;
+        return true;
+    }
+    if (mUrgent.IsFull())
+    {
+        --mScheduled;
+        return false;
+    }
+    mUrgent.Push({{OrderCommandType::AMEND, Side::SELL, Lifespan::FILL_AND_KILL, clientOrderId, 0, volume},
+                  clientOrderId});
+    return true;
+}
+
+bool OrderScheduler::ScheduleCancel(unsigned long clientOrderId)
+{
+    ++mScheduled;
+    if (ScheduledOrder* waiting = mUrgent.Find(OrderCommandType::AMEND, clientOrderId))
+    {
+        waiting->mCommand.mType = OrderCommandType::CANCEL;
+        ++mCoalesced;
+        return true;
+    }
+    if (mUrgent.Find(OrderCommandType::CANCEL, clientOrderId))
+    {
+        ++mCoalesced;
+        return true;
+    }
+    if (mUrgent.IsFull())
+    {
+        --mScheduled;
+        return false;
+    }
+    mUrgent.Push({{OrderCommandType::CANCEL, Side::SELL, Lifespan::FILL_AND_KILL, clientOrderId, 0, 0},
+                  clientOrderId});
+    return true;
+}
+
+bool OrderScheduler::ScheduleHedge(unsigned long key, Side side, unsigned long price, unsigned long volume)
+{
+    if (mUrgent.IsFull())
+    {
+        return false;
+    }
+    ++mScheduled;
+    mUrgent.Push({{OrderCommandType::HEDGE, side, Lifespan::FILL_AND_KILL, 0, price, volume}, key});
+    return true;
+}
+
+bool OrderScheduler::ScheduleInsert(unsigned long key,
+                                    Side side,
+                                    unsigned long price,
+                                    unsigned long volume,
+                                    Lifespan lifespan)
+{
+    if (ScheduledOrder* waiting = mInserts.Find(OrderCommandType::INSERT, key))
+    {
+        ++mScheduled;
+        ++mCoalesced;
+        waiting->mCommand = OrderCommand{OrderCommandType::INSERT, side, lifespan, 0, price, volume};
+        return true;
+    }
+    if (mInserts.IsFull())
+    {
+        return false;
+    }
+    ++mScheduled;
+    mInserts.Push({{OrderCommandType::INSERT, side, lifespan, 0, price, volume}, key});
+    return true;
+}
+
+bool OrderScheduler::Unschedule(unsigned long key)
+{
+    if (!mInserts.Remove(OrderCommandType::INSERT, key))
+    {
+        return false;
+    }
+    ++mCoalesced;
+    return true;
+}
+
+bool OrderScheduler::Requeue(const ScheduledOrder& order)
+{
+    const OrderCommand& command = order.mCommand;
+    switch (command.mType)
+    {
+    case OrderCommandType::AMEND:
+        if (mUrgent.Find(OrderCommandType::AMEND, order.mKey) || mUrgent.Find(OrderCommandType::CANCEL, order.mKey))
+        {
+            return true;
+        }
+        break;
+    case OrderCommandType::CANCEL:
+        if (ScheduledOrder* waiting = mUrgent.Find(OrderCommandType::AMEND, order.mKey))
+        {
+            waiting->mCommand.mType = OrderCommandType::CANCEL;
+            return true;
+        }
+        if (mUrgent.Find(OrderCommandType::CANCEL, order.mKey))
+        {
+            return true;
+        }
+        break;
+    case OrderCommandType::INSERT:
+        if (mInserts.Find(OrderCommandType::INSERT, order.mKey))
+        {
+            return true;
+        }
+        break;
+    case OrderCommandType::HEDGE:
+        break;
+    }
+
+    Ring& ring = (command.mType == OrderCommandType::INSERT) ? mInserts : mUrgent;
+    if (ring.IsFull())
+    {
+        return false;
+    }
+    ring.Push(order);
+    ++mRequeued;
+    return true;
+}
+
+void OrderScheduler::WakeAt(Clock::time_point time)
+{
+    if (mIsWaiting && mTimer.expiry() <= time)
+    {
+        return;
+    }
+    // Moving the expiry of a pending wait cancels it, and its handler
+    // then ignores the operation_aborted error.
+    mTimer.expires_at(time);
+    mIsWaiting = true;
+    mTimer.async_wait(makeAllocatingHandler(mTimerMemory, [this](auto& error) { WakeupHandler(error); }));
+}
+
+void OrderScheduler::WakeupHandler(const boost::system::error_code& error)
+{
+    if (error)
+    {
+        if (error != boost::asio::error::operation_aborted)
+        {
+            RLOG(LG_SCHED, LogLevel::LL_ERROR) << "order scheduler wakeup failed: " << error.message();
+        }
+        return;
+    }
+
+    mIsWaiting = false;
+    ++mWakeups;
+    if (BudgetAvailable)
+    {
+        BudgetAvailable();
+    }
+}
+
+}
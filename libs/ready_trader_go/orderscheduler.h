@@ -0,0 +1,172 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_ORDERSCHEDULER_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_ORDERSCHEDULER_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/system/error_code.hpp>
+
+#include "handlermemory.h"
+#include "ordercommands.h"
+#include "types.h"
+
+namespace ReadyTraderGo {
+
+constexpr std::size_t DEFAULT_ORDER_SCHEDULER_CAPACITY = 64;
+
+// An order waiting for message budget. Inserts and hedges are given their
+// client order id when they are sent and are known until then by a key
+// the caller chooses; amends and cancels are keyed by the id of the order
+// they apply to.
+struct ScheduledOrder
+{
+    OrderCommand mCommand;
+    unsigned long mKey;
+};
+
+// Holds orders back until the message frequency limit allows them to be
+// sent.
+//
+// Orders wait in two fixed rings: one for cancels, amends and hedges,
+// which are always sent first, and one for inserts. An order that is
+// overtaken before it is sent is updated where it waits rather than
+// queued again: a newer insert with the same key replaces the older one,
+// a newer amend of the same order replaces the older one, and a cancel
+// replaces a waiting amend. Superseded quotes therefore never cost a
+// message. Nothing is allocated after construction.
+//
+// The owner releases orders whenever it likes, and asks to be woken, with
+// BudgetAvailable, at the time the next message will be allowed.
+class OrderScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit OrderScheduler(boost::asio::io_context& context,
+                            std::size_t capacity = DEFAULT_ORDER_SCHEDULER_CAPACITY);
+    ~OrderScheduler();
+
+    OrderScheduler(const OrderScheduler&) = delete;
+    OrderScheduler& operator=(const OrderScheduler&) = delete;
+
+    // Each returns false if the order's ring is full.
+    bool ScheduleAmend(unsigned long clientOrderId, unsigned long volume);
+    bool ScheduleCancel(unsigned long clientOrderId);
+    bool ScheduleHedge(unsigned long key, Side side, unsigned long price, unsigned long volume);
+    bool ScheduleInsert(unsigned long key, Side side, unsigned long price, unsigned long volume, Lifespan lifespan);
+
+    // Forget a waiting insert, returning false if there was none.
+    bool Unschedule(unsigned long key);
+
+    // Put back a released order that could not be sent, unless a newer
+    // order has superseded it in the meantime. Returns false if the
+    // order's ring is full.
+    bool Requeue(const ScheduledOrder& order);
+
+    bool IsEmpty() const { return mUrgent.IsEmpty() && mInserts.IsEmpty(); }
+
+    // Pass waiting orders, most urgent first, to handler for as long as
+    // isAvailable returns true, and return the count. Orders the handler
+    // requeues are not passed to it again by the same call.
+    template<typename P, typename F>
+    std::size_t Release(P&& isAvailable, F&& handler);
+
+    // Call BudgetAvailable at the given time, unless already due to be
+    // called by then.
+    void WakeAt(Clock::time_point time);
+
+    std::function<void()> BudgetAvailable;
+
+private:
+    class Ring
+    {
+    public:
+        explicit Ring(std::size_t capacity);
+
+        bool IsEmpty() const { return mHead == mTail; }
+        std::size_t GetSize() const { return mTail - mHead; }
+        bool IsFull() const { return mTail - mHead == mCapacity; }
+
+        void Push(const ScheduledOrder& order) { mSlots[mTail++ & mMask] = Slot{order, false}; }
+
+        // Take the oldest waiting order, or return false if there is none.
+        bool TryPop(ScheduledOrder& order);
+
+        // Return the first waiting order of the given type and key, if any.
+        ScheduledOrder* Find(OrderCommandType type, unsigned long key);
+        bool Remove(OrderCommandType type, unsigned long key);
+
+    private:
+        struct Slot
+        {
+            ScheduledOrder mOrder;
+            bool mIsRemoved;
+        };
+
+        Slot* FindSlot(OrderCommandType type, unsigned long key);
+        void SkipRemoved();
+
+        std::size_t mCapacity;
+        std::size_t mMask;
+        std::unique_ptr<Slot[]> mSlots;
+        std::size_t mHead = 0;
+        std::size_t mTail = 0;
+    };
+
+    void WakeupHandler(const boost::system::error_code& error);
+
+    Ring mUrgent;
+    Ring mInserts;
+
+    boost::asio::steady_timer mTimer;
+    bool mIsWaiting = false;
+    HandlerMemory mTimerMemory;
+
+    unsigned long mScheduled = 0;
+    unsigned long mCoalesced = 0;
+    unsigned long mReleased = 0;
+    unsigned long mRequeued = 0;
+    unsigned long mWakeups = 0;
+};
+
+template<typename P, typename F>
+std::size_t OrderScheduler::Release(P&& isAvailable, F&& handler)
+{
+    std::size_t count = 0;
+    for (Ring* ring : {&mUrgent, &mInserts})
+    {
+        ScheduledOrder order;
+        for (std::size_t waiting = ring->GetSize(); waiting != 0 && isAvailable() && ring->TryPop(order); --waiting)
+        {
+            handler(order);
+            ++count;
+        }
+    }
+    mReleased += count;
+    return count;
+}
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_ORDERSCHEDULER_H
@@ -0,0 +1,437 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#include <cstring>
+#include <iomanip>
+#include <stdexcept>
+#include <utility>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/endian/conversion.hpp>
+
+#include "error.h"
+#include "logging.h"
+#include "pipeline.h"
+
+RTG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_PIPE, "PIPELINE")
+
+namespace ReadyTraderGo {
+
+PipelineSlot& PipelineQueue::Prepare()
+{
+    PipelineSlot* slot = mQueue.Prepare();
+    while (slot == nullptr)
+    {
+        ++mStalls;
+        if (mIsAbandoned.load(std::memory_order_acquire))
+        {
+            throw ReadyTraderGoError("pipeline queue '" + mName + "' is full and has no consumer");
+        }
+        std::this_thread::yield();
+        slot = mQueue.Prepare();
+    }
+    return *slot;
+}
+
+void PipelineQueue::Commit(PipelineSlot& slot)
+{
+    slot.mTimestamp = Now();
+    mQueue.Commit();
+    ++mPushes;
+}
+
+void PipelineQueue::Report() const
+{
+    RLOG(LG_PIPE, LogLevel::LL_INFO) << "queue " << std::quoted(mName, '\'') << " capacity="
+                                     << mQueue.GetCapacity() << " pushes=" << mPushes << " stalls="
+                                     << mStalls << " pops=" << mPops << " max_depth=" << mMaxDepth
+                                     << " mean_latency_ns=" << (mPops != 0 ? mTotalLatency / mPops : 0)
+                                     << " max_latency_ns=" << mMaxLatency;
+}
+
+// Queue a message body, which must fit in a single slot.
+static void queueMessage(PipelineQueue& queue,
+                         PipelineSlotKind kind,
+                         unsigned char messageType,
+                         unsigned char const* data,
+                         std::size_t size)
+{
+    if (size > PipelineSlot::DATA_SIZE)
+    {
+        throw ReadyTraderGoError("message of " + std::to_string(size) + " bytes is too big for a pipeline slot");
+    }
+
+    PipelineSlot& slot = queue.Prepare();
+    slot.mKind = kind;
+    slot.mType = messageType;
+    slot.mSize = static_cast<uint16_t>(size);
+    if (size != 0)
+    {
+        std::memcpy(slot.mData, data, size);
+    }
+    queue.Commit(slot);
+}
+
+QueuedConnection::QueuedConnection(boost::asio::io_context& context,
+                                   std::shared_ptr<PipelineQueue> inbound,
+                                   std::shared_ptr<PipelineQueue> outbound,
+                                   bool isPolledExternally)
+    : mContext(context),
+      mInbound(std::move(inbound)),
+      mOutbound(std::move(outbound)),
+      mIsPolledExternally(isPolledExternally)
+{
+}
+
+void QueuedConnection::AsyncRead()
+{
+    if (!mIsPolledExternally)
+    {
+        PostPoll();
+    }
+}
+
+void QueuedConnection::PostPoll()
+{
+    boost::asio::post(mContext, makeAllocatingHandler(mPollMemory, [this] { PollAndRepost(); }));
+}
+
+void QueuedConnection::PollAndRepost()
+{
+    Poll();
+    if (!mIsClosed)
+    {
+        PostPoll();
+    }
+}
+
+std::size_t QueuedConnection::Poll()
+{
+    if (mIsClosed)
+    {
+        return 0;
+    }
+
+    return mInbound->Consume([this](const PipelineSlot& slot) {
+        if (mIsClosed)
+        {
+            return;
+        }
+        if (slot.mKind == PipelineSlotKind::DISCONNECT)
+        {
+            mIsClosed = true;
+            OnDisconnect();
+            return;
+        }
+        OnMessageReceipt(slot.mType, slot.mData, slot.mSize);
+    });
+}
+
+void QueuedConnection::Flush()
+{
+    // Every message is visible to the gateway as soon as it is queued, and
+    // the gateway writes everything it finds queued together.
+}
+
+void QueuedConnection::SendFrame(unsigned char const* frame, std::size_t size, SendMode)
+{
+    queueMessage(*mOutbound, PipelineSlotKind::MESSAGE, frame[MESSAGE_TYPE_OFFSET], frame, size);
+    mStatistics.mMessagesSent++;
+    mStatistics.mBytesSent += size;
+}
+
+void QueuedConnection::SendMessage(unsigned char messageType, const ISerialisable& serialisable, SendMode)
+{
+    const std::size_t size = MESSAGE_HEADER_SIZE + serialisable.Size();
+    if (size > PipelineSlot::DATA_SIZE)
+    {
+        throw ReadyTraderGoError("message of " + std::to_string(size) + " bytes is too big for a pipeline slot");
+    }
+
+    PipelineSlot& slot = mOutbound->Prepare();
+    slot.mKind = PipelineSlotKind::MESSAGE;
+    slot.mType = messageType;
+    slot.mSize = static_cast<uint16_t>(size);
+    *(uint16_t*)slot.mData = boost::endian::native_to_big((uint16_t)size);
+    slot.mData[MESSAGE_TYPE_OFFSET] = messageType;
+    serialisable.Serialise(slot.mData + MESSAGE_HEADER_SIZE);
+    mOutbound->Commit(slot);
+
+    mStatistics.mMessagesSent++;
+    mStatistics.mBytesSent += size;
+}
+
+QueuedSubscription::QueuedSubscription(boost::asio::io_context& context,
+                                       std::shared_ptr<PipelineQueue> queue,
+                                       bool isPolledExternally)
+    : mContext(context), mQueue(std::move(queue)), mIsPolledExternally(isPolledExternally)
+{
+}
+
+void QueuedSubscription::AsyncReceive()
+{
+    if (mIsPolledExternally)
+    {
+        return;
+    }
+
+    PostReceive(shared_from_this());
+}
+
+void QueuedSubscription::AsyncReceive(std::weak_ptr<ISubscription> weak_this)
+{
+    if (weak_this.expired())
+    {
+        return;
+    }
+
+    Poll();
+    if (!mIsClosed)
+    {
+        PostReceive(std::move(weak_this));
+    }
+}
+
+void QueuedSubscription::PostReceive(std::weak_ptr<ISubscription> weak_this)
+{
+    boost::asio::post(mContext, makeAllocatingHandler(mPollMemory, [this, weak_this = std::move(weak_this)]() {
+        AsyncReceive(weak_this);
+    }));
+}
+
+std::size_t QueuedSubscription::Poll()
+{
+    if (mIsClosed)
+    {
+        return 0;
+    }
+
+    return mQueue->Consume([this](const PipelineSlot& slot) {
+        unsigned long first;
+        unsigned long second;
+        if (mIsClosed)
+        {
+            return;
+        }
+        switch (slot.mKind)
+        {
+        case PipelineSlotKind::MESSAGE:
+            ++mStatistics.mFramesReceived;
+            OnMessageReceipt(slot.mType, slot.mData, slot.mSize);
+            break;
+        case PipelineSlotKind::OVERRUN:
+            std::memcpy(&first, slot.mData, sizeof(first));
+            ++mStatistics.mOverruns;
+            mStatistics.mFramesSkipped += first;
+            OnOverrun(first);
+            break;
+        case PipelineSlotKind::SEQUENCE_GAP:
+            std::memcpy(&first, slot.mData + 1, sizeof(first));
+            std::memcpy(&second, slot.mData + 1 + sizeof(first), sizeof(second));
+            ++mStatistics.mSequenceGaps;
+            if (second > first)
+            {
+                mStatistics.mMessagesMissed += second - first;
+            }
+            OnSequenceGap(slot.mType, slot.mData[0], first, second);
+            break;
+        case PipelineSlotKind::DISCONNECT:
+            mIsClosed = true;
+            OnDisconnect();
+            break;
+        }
+    });
+}
+
+Pipeline::Pipeline(const PipelineSettings& settings)
+    : mSettings(settings),
+      mFeedContext(1),
+      mGatewayContext(1),
+      mFeedQueue(std::make_shared<PipelineQueue>("feed->strategy", settings.mQueueCapacity)),
+      mInboundQueue(std::make_shared<PipelineQueue>("gateway->strategy", settings.mQueueCapacity)),
+      mOutboundQueue(std::make_shared<PipelineQueue>("strategy->gateway", settings.mQueueCapacity))
+{
+}
+
+Pipeline::~Pipeline()
+{
+    Stop();
+    mFeedQueue->Report();
+    mInboundQueue->Report();
+    mOutboundQueue->Report();
+}
+
+void Pipeline::Start(std::unique_ptr<IConnection> connection, std::shared_ptr<ISubscription> subscription)
+{
+    mConnection = std::move(connection);
+    mSubscription = std::move(subscription);
+
+    // These run on the gateway and feed threads respectively.
+    mConnection->MessageReceived = [this](IConnection*, unsigned char type, unsigned char const* data,
+                                          std::size_t size) {
+        queueMessage(*mInboundQueue, PipelineSlotKind::MESSAGE, type, data, size);
+    };
+    mConnection->Disconnected = [this] {
+        mIsDisconnected = true;
+        queueMessage(*mInboundQueue, PipelineSlotKind::DISCONNECT, 0, nullptr, 0);
+    };
+
+    mSubscription->MessageReceived = [this](ISubscription*, unsigned char type, unsigned char const* data,
+                                            std::size_t size) {
+        queueMessage(*mFeedQueue, PipelineSlotKind::MESSAGE, type, data, size);
+    };
+    mSubscription->Overrun = [this](ISubscription*, std::size_t framesSkipped) {
+        const unsigned long skipped = framesSkipped;
+        queueMessage(*mFeedQueue, PipelineSlotKind::OVERRUN, 0, (unsigned char const*)&skipped, sizeof(skipped));
+    };
+    mSubscription->SequenceGap = [this](ISubscription*, unsigned char type, unsigned char instrument,
+                                        unsigned long expected, unsigned long received) {
+        unsigned char data[1 + 2 * sizeof(unsigned long)];
+        data[0] = instrument;
+        std::memcpy(data + 1, &expected, sizeof(expected));
+        std::memcpy(data + 1 + sizeof(expected), &received, sizeof(received));
+        queueMessage(*mFeedQueue, PipelineSlotKind::SEQUENCE_GAP, type, data, sizeof(data));
+    };
+
+    RLOG(LG_PIPE, LogLevel::LL_INFO) << "starting pipeline with queue capacity " << mSettings.mQueueCapacity
+                                     << (mSettings.mYieldWhenIdle ? ", yielding" : ", spinning")
+                                     << " when idle";
+
+    mGatewayThread = std::thread([this] { GatewayLoop(); });
+    mFeedThread = std::thread([this] { FeedLoop(); });
+}
+
+std::unique_ptr<QueuedConnection> Pipeline::CreateConnection(boost::asio::io_context& context,
+                                                             bool isPolledExternally)
+{
+    auto connection = std::make_unique<QueuedConnection>(context, mInboundQueue, mOutboundQueue,
+                                                         isPolledExternally);
+    connection->SetName(mConnection->GetName());
+    return connection;
+}
+
+std::shared_ptr<QueuedSubscription> Pipeline::CreateSubscription(boost::asio::io_context& context,
+                                                                 bool isPolledExternally)
+{
+    auto subscription = std::make_shared<QueuedSubscription>(context, mFeedQueue, isPolledExternally);
+    subscription->SetName(mSubscription->GetName());
+    return subscription;
+}
+
+void Pipeline::Stop()
+{
+    if (mIsStopping.exchange(true))
+    {
+        return;
+    }
+
+    // The strategy has stopped consuming, so a feed or gateway thread
+    // waiting for space must give up rather than wait forever.
+    mFeedQueue->Abandon();
+    mInboundQueue->Abandon();
+
+    if (mFeedThread.joinable())
+    {
+        mFeedThread.join();
+    }
+    if (mGatewayThread.joinable())
+    {
+        mGatewayThread.join();
+    }
+}
+
+void Pipeline::Idle(std::size_t count) const
+{
+    if (count == 0 && mSettings.mYieldWhenIdle)
+    {
+        std::this_thread::yield();
+    }
+}
+
+void Pipeline::FeedLoop()
+{
+    try
+    {
+        configureCurrentThread(mSettings.mFeedThread, "feed");
+        auto work = boost::asio::make_work_guard(mFeedContext);
+        while (!mIsStopping.load(std::memory_order_relaxed))
+        {
+            std::size_t count = mSubscription->Poll();
+            count += mFeedContext.poll();
+            Idle(count);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        // Tell the strategy, as the gateway thread does, rather than leave
+        // it waiting for market data that will never come.
+        RLOG(LG_PIPE, LogLevel::LL_ERROR) << "feed thread failed: " << e.what();
+        try
+        {
+            queueMessage(*mFeedQueue, PipelineSlotKind::DISCONNECT, 0, nullptr, 0);
+        }
+        catch (const ReadyTraderGoError&)
+        {
+        }
+    }
+}
+
+void Pipeline::GatewayLoop()
+{
+    try
+    {
+        configureCurrentThread(mSettings.mGatewayThread, "gateway");
+        auto work = boost::asio::make_work_guard(mGatewayContext);
+        mConnection->AsyncRead();
+        while (!mIsStopping.load(std::memory_order_relaxed))
+        {
+            std::size_t count = 0;
+            if (!mOutboundQueue->IsEmpty())
+            {
+                // Everything the strategy has queued so far leaves together.
+                SendBatch<IConnection> batch(*mConnection);
+                count += mOutboundQueue->Consume([this](const PipelineSlot& slot) {
+                    if (!mIsDisconnected)
+                    {
+                        mConnection->SendFrame(slot.mData, slot.mSize, SendMode::ASAP);
+                    }
+                });
+            }
+            count += mGatewayContext.poll();
+            Idle(count);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        RLOG(LG_PIPE, LogLevel::LL_ERROR) << "gateway thread failed: " << e.what();
+        mOutboundQueue->Abandon();
+        if (!mIsDisconnected)
+        {
+            mIsDisconnected = true;
+            try
+            {
+                queueMessage(*mInboundQueue, PipelineSlotKind::DISCONNECT, 0, nullptr, 0);
+            }
+            catch (const ReadyTraderGoError&)
+            {
+            }
+        }
+    }
+}
+
+}
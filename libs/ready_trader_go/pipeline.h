@@ -0,0 +1,261 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_PIPELINE_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_PIPELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <boost/asio/io_context.hpp>
+
+#include "buffers.h"
+#include "connectivitytypes.h"
+#include "handlermemory.h"
+#include "spscqueue.h"
+#include "threading.h"
+
+namespace ReadyTraderGo {
+
+constexpr std::size_t PIPELINE_SLOT_SIZE = 128;
+constexpr std::size_t DEFAULT_PIPELINE_QUEUE_CAPACITY = 4096;
+
+enum class PipelineSlotKind : unsigned char
+{
+    MESSAGE,
+    OVERRUN,
+    SEQUENCE_GAP,
+    DISCONNECT
+};
+
+// One entry in a pipeline queue: a message body (or, from the strategy to
+// the gateway, a complete frame) together with the time it was queued.
+struct alignas(CACHE_LINE_SIZE) PipelineSlot
+{
+    static constexpr std::size_t DATA_SIZE = PIPELINE_SLOT_SIZE - sizeof(uint64_t) - sizeof(uint16_t) - 2;
+
+    uint64_t mTimestamp; // steady clock nanoseconds
+    uint16_t mSize;
+    PipelineSlotKind mKind;
+    unsigned char mType;
+    unsigned char mData[DATA_SIZE];
+};
+
+static_assert(sizeof(PipelineSlot) == PIPELINE_SLOT_SIZE, "pipeline slots must be exactly PIPELINE_SLOT_SIZE");
+
+// An SpscQueue of PipelineSlots that measures itself. The producer counts
+// the slots it queued and the times it found the queue full; the consumer
+// records the deepest the queue has been and how long slots waited in it.
+// Each side's counters are only touched by that side's thread.
+class PipelineQueue
+{
+public:
+    PipelineQueue(std::string name, std::size_t capacity) : mQueue(capacity), mName(std::move(name)) {}
+
+    // Producer: return the next free slot, yielding for as long as the
+    // queue is full. Throws if the consumer has gone away.
+    PipelineSlot& Prepare();
+    void Commit(PipelineSlot& slot);
+
+    // Consumer: pass each queued slot to handler and return the count.
+    template<typename F>
+    std::size_t Consume(F&& handler);
+    bool IsEmpty() { return mQueue.Front() == nullptr; }
+
+    // Called once the consumer will take no more slots.
+    void Abandon() { mIsAbandoned.store(true, std::memory_order_release); }
+
+    // Log the statistics of both sides. Only call once both threads have
+    // finished with the queue.
+    void Report() const;
+
+    static uint64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    SpscQueue<PipelineSlot> mQueue;
+    std::string mName;
+    std::atomic<bool> mIsAbandoned{false};
+
+    alignas(CACHE_LINE_SIZE) unsigned long mPushes = 0;
+    unsigned long mStalls = 0;
+
+    alignas(CACHE_LINE_SIZE) unsigned long mPops = 0;
+    std::size_t mMaxDepth = 0;
+    uint64_t mTotalLatency = 0;
+    uint64_t mMaxLatency = 0;
+};
+
+struct PipelineSettings
+{
+    std::size_t mQueueCapacity = DEFAULT_PIPELINE_QUEUE_CAPACITY;
+    bool mYieldWhenIdle = false; // otherwise the feed and gateway threads spin
+    ThreadSettings mFeedThread;
+    ThreadSettings mGatewayThread;
+};
+
+// The strategy thread's end of the execution connection. Sent messages
+// are queued for the gateway thread, which writes them, and messages the
+// gateway receives are delivered by Poll.
+class QueuedConnection : public IConnection
+{
+public:
+    QueuedConnection(boost::asio::io_context& context,
+                     std::shared_ptr<PipelineQueue> inbound,
+                     std::shared_ptr<PipelineQueue> outbound,
+                     bool isPolledExternally);
+
+    void AsyncRead() override;
+    void Flush() override;
+    void SendFrame(unsigned char const* frame, std::size_t size, SendMode mode) override;
+    void SendMessage(unsigned char messageType, const ISerialisable& serialisable, SendMode mode) override;
+    using IConnection::SendMessage;
+
+    // Deliver whatever the gateway has queued and return the count.
+    std::size_t Poll();
+
+private:
+    void PollAndRepost();
+    void PostPoll();
+
+    boost::asio::io_context& mContext;
+    std::shared_ptr<PipelineQueue> mInbound;
+    std::shared_ptr<PipelineQueue> mOutbound;
+    bool mIsPolledExternally;
+    bool mIsClosed = false;
+    HandlerMemory mPollMemory;
+};
+
+// The strategy thread's end of the information subscription.
+class QueuedSubscription : public ISubscription
+{
+public:
+    QueuedSubscription(boost::asio::io_context& context,
+                       std::shared_ptr<PipelineQueue> queue,
+                       bool isPolledExternally);
+
+    void AsyncReceive() override;
+    std::size_t Poll() override;
+
+private:
+    void AsyncReceive(std::weak_ptr<ISubscription>);
+    void PostReceive(std::weak_ptr<ISubscription>);
+
+    boost::asio::io_context& mContext;
+    std::shared_ptr<PipelineQueue> mQueue;
+    bool mIsPolledExternally;
+    bool mIsClosed = false;
+    HandlerMemory mPollMemory;
+};
+
+// Runs the information subscription and the execution connection on
+// threads of their own, so that neither decoding market data nor socket
+// I/O holds up the strategy, which runs on the application's thread.
+//
+//   feed thread:     polls the subscription and queues each message;
+//   gateway thread:  runs the connection, queues what it receives and
+//                    writes what the strategy has queued; and
+//   strategy thread: delivers queued messages to the auto-trader through
+//                    a QueuedConnection and a QueuedSubscription.
+//
+// Each pair of threads is joined by a PipelineQueue, whose depth and
+// latency statistics are logged when the pipeline is destroyed. The feed
+// and gateway threads never block; each pass polls everything they own.
+class Pipeline
+{
+public:
+    explicit Pipeline(const PipelineSettings& settings);
+    ~Pipeline();
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    // The contexts on which the subscription and connection are created.
+    boost::asio::io_context& GetFeedContext() { return mFeedContext; }
+    boost::asio::io_context& GetGatewayContext() { return mGatewayContext; }
+
+    // Take ownership of the connection and subscription and start their
+    // threads. The subscription must be polled externally.
+    void Start(std::unique_ptr<IConnection> connection, std::shared_ptr<ISubscription> subscription);
+
+    // Return the strategy thread's ends of the pipeline.
+    std::unique_ptr<QueuedConnection> CreateConnection(boost::asio::io_context& context, bool isPolledExternally);
+    std::shared_ptr<QueuedSubscription> CreateSubscription(boost::asio::io_context& context,
+                                                           bool isPolledExternally);
+
+    // Stop and join the feed and gateway threads.
+    void Stop();
+
+private:
+    void FeedLoop();
+    void GatewayLoop();
+    void Idle(std::size_t count) const;
+
+    PipelineSettings mSettings;
+    boost::asio::io_context mFeedContext;
+    boost::asio::io_context mGatewayContext;
+
+    std::shared_ptr<PipelineQueue> mFeedQueue; // feed -> strategy
+    std::shared_ptr<PipelineQueue> mInboundQueue; // gateway -> strategy
+    std::shared_ptr<PipelineQueue> mOutboundQueue; // strategy -> gateway
+
+    std::unique_ptr<IConnection> mConnection;
+    std::shared_ptr<ISubscription> mSubscription;
+    bool mIsDisconnected = false; // gateway thread only
+
+    std::atomic<bool> mIsStopping{false};
+    std::thread mFeedThread;
+    std::thread mGatewayThread;
+};
+
+template<typename F>
+std::size_t PipelineQueue::Consume(F&& handler)
+{
+    std::size_t count = 0;
+    while (PipelineSlot* slot = mQueue.Front())
+    {
+        if (mQueue.GetDepth() > mMaxDepth)
+        {
+            mMaxDepth = mQueue.GetDepth();
+        }
+
+        const uint64_t latency = Now() - slot->mTimestamp;
+        mTotalLatency += latency;
+        if (latency > mMaxLatency)
+        {
+            mMaxLatency = latency;
+        }
+
+        handler(*slot);
+        mQueue.Pop();
+        ++count;
+    }
+    mPops += count;
+    return count;
+}
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_PIPELINE_H
@@ -15,304 +15,177 @@
 //     You should have received a copy of the GNU Affero General Public
 //     License along with Ready Trader Go.  If not, see
 //     <https://www.gnu.org/licenses/>.
-#include <cstring>
-#include <string>
-
-#include <boost/endian/conversion.hpp>
-
 #include "protocol.h"
 
 namespace ReadyTraderGo {
 
-static std::string readFixedLengthString(unsigned char const* data, std::size_t maxSize)
-{
-    auto loc = (decltype(data)) std::memchr(data, 0, maxSize);
-    auto len = (loc != nullptr) ? loc - data : maxSize;
-    return std::string((char const*) data, len);
-}
+// Guard against the schemas drifting from the exchange's wire format.
+static_assert(messageSize<InsertMessage>() == 17, "insert message size mismatch");
+static_assert(messageSize<OrderBookMessage>() == 88, "order book message size mismatch");
 
-static void writeFixedLengthString(const std::string& message, unsigned char* buf, std::size_t maxSize)
+std::size_t AmendMessage::Size() const noexcept
 {
-    auto len = message.length();
-    std::memcpy(buf, message.c_str(), len);
-    if (len < maxSize)
-    {
-        std::memset(buf + len, 0, maxSize - len);
-    }
+    return MessageTraits<AmendMessage>::Schema::SIZE;
 }
 
 void AmendMessage::Deserialise(unsigned char const* data, std::size_t)
 {
-    mClientOrderId = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-    mNewVolume = boost::endian::big_to_native(*(uint32_t*)data);
+    MessageTraits<AmendMessage>::Schema::Decode(*this, data);
 }
 
 void AmendMessage::Serialise(unsigned char* buf) const
 {
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mClientOrderId);
-    buf += MessageFieldSize::LONG;
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mNewVolume);
+    MessageTraits<AmendMessage>::Schema::Encode(*this, buf);
+}
+
+std::size_t CancelMessage::Size() const noexcept
+{
+    return MessageTraits<CancelMessage>::Schema::SIZE;
 }
 
 void CancelMessage::Deserialise(unsigned char const* data, std::size_t)
 {
-    mClientOrderId = boost::endian::big_to_native(*(uint32_t*)data);
+    MessageTraits<CancelMessage>::Schema::Decode(*this, data);
 }
 
 void CancelMessage::Serialise(unsigned char* buf) const
 {
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mClientOrderId);
+    MessageTraits<CancelMessage>::Schema::Encode(*this, buf);
+}
+
+std::size_t ErrorMessage::Size() const noexcept
+{
+    return MessageTraits<ErrorMessage>::Schema::SIZE;
 }
 
 void ErrorMessage::Deserialise(unsigned char const* data, std::size_t)
 {
-    mClientOrderId = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-    mMessage = readFixedLengthString(data, MessageFieldSize::STRING);
+    MessageTraits<ErrorMessage>::Schema::Decode(*this, data);
 }
 
 void ErrorMessage::Serialise(unsigned char* buf) const
 {
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mClientOrderId);
-    buf += MessageFieldSize::LONG;
-    writeFixedLengthString(mMessage, buf, MessageFieldSize::STRING);
+    MessageTraits<ErrorMessage>::Schema::Encode(*this, buf);
+}
+
+std::size_t HedgeMessage::Size() const noexcept
+{
+    return MessageTraits<HedgeMessage>::Schema::SIZE;
 }
 
 void HedgeMessage::Deserialise(unsigned char const* data, std::size_t)
 {
-    mClientOrderId = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-    mSide = Side(*data);
-    data += MessageFieldSize::BYTE;
-    mPrice = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-    mVolume = boost::endian::big_to_native(*(uint32_t*)data);
+    MessageTraits<HedgeMessage>::Schema::Decode(*this, data);
 }
 
 void HedgeMessage::Serialise(unsigned char* buf) const
 {
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mClientOrderId);
-    buf += MessageFieldSize::LONG;
-    *buf = static_cast<unsigned char>(mSide);
-    buf += MessageFieldSize::BYTE;
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mPrice);
-    buf += MessageFieldSize::LONG;
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mVolume);
+    MessageTraits<HedgeMessage>::Schema::Encode(*this, buf);
+}
+
+std::size_t HedgeFilledMessage::Size() const noexcept
+{
+    return MessageTraits<HedgeFilledMessage>::Schema::SIZE;
 }
 
 void HedgeFilledMessage::Deserialise(unsigned char const* data, std::size_t)
 {
-    mClientOrderId = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-    mPrice = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-    mVolume = boost::endian::big_to_native(*(uint32_t*)data);
+    MessageTraits<HedgeFilledMessage>::Schema::Decode(*this, data);
 }
 
 void HedgeFilledMessage::Serialise(unsigned char* buf) const
 {
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mClientOrderId);
-    buf += MessageFieldSize::LONG;
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mPrice);
-    buf += MessageFieldSize::LONG;
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mVolume);
+    MessageTraits<HedgeFilledMessage>::Schema::Encode(*this, buf);
+}
+
+std::size_t InsertMessage::Size() const noexcept
+{
+    return MessageTraits<InsertMessage>::Schema::SIZE;
 }
 
 void InsertMessage::Deserialise(unsigned char const* data, std::size_t)
 {
-    mClientOrderId = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-    mSide = Side(*data);
-    data += MessageFieldSize::BYTE;
-    mPrice = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-    mVolume = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-    mLifespan = Lifespan(*data);
+    MessageTraits<InsertMessage>::Schema::Decode(*this, data);
 }
 
 void InsertMessage::Serialise(unsigned char* buf) const
 {
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mClientOrderId);
-    buf += MessageFieldSize::LONG;
-    *buf = static_cast<unsigned char>(mSide);
-    buf += MessageFieldSize::BYTE;
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mPrice);
-    buf += MessageFieldSize::LONG;
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mVolume);
-    buf += MessageFieldSize::LONG;
-    *buf = static_cast<unsigned char>(mLifespan);
+    MessageTraits<InsertMessage>::Schema::Encode(*this, buf);
+}
+
+std::size_t LoginMessage::Size() const noexcept
+{
+    return MessageTraits<LoginMessage>::Schema::SIZE;
 }
 
 void LoginMessage::Deserialise(unsigned char const* data, std::size_t)
 {
-    mName = readFixedLengthString(data, MessageFieldSize::STRING);
-    data += MessageFieldSize::STRING;
-    mSecret = readFixedLengthString(data, MessageFieldSize::STRING);
+    MessageTraits<LoginMessage>::Schema::Decode(*this, data);
 }
 
 void LoginMessage::Serialise(unsigned char* buf) const
 {
-    writeFixedLengthString(mName, buf, MessageFieldSize::STRING);
-    buf += MessageFieldSize::STRING;
-    writeFixedLengthString(mSecret, buf, MessageFieldSize::STRING);
+    MessageTraits<LoginMessage>::Schema::Encode(*this, buf);
+}
+
+std::size_t OrderBookMessage::Size() const noexcept
+{
+    return MessageTraits<OrderBookMessage>::Schema::SIZE;
 }
 
 void OrderBookMessage::Deserialise(unsigned char const* data, std::size_t)
 {
-    mInstrument = Instrument(*data);
-    data += MessageFieldSize::BYTE;
-    mSequenceNumber = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-
-    for (auto& p : mAskPrices)
-    {
-        p = boost::endian::big_to_native(*(uint32_t*)data);
-        data += MessageFieldSize::LONG;
-    }
-    for (auto& v : mAskVolumes)
-    {
-        v = boost::endian::big_to_native(*(uint32_t*)data);
-        data += MessageFieldSize::LONG;
-    }
-    for (auto& p : mBidPrices)
-    {
-        p = boost::endian::big_to_native(*(uint32_t*)data);
-        data += MessageFieldSize::LONG;
-    }
-    for (auto& v : mBidVolumes)
-    {
-        v = boost::endian::big_to_native(*(uint32_t*)data);
-        data += MessageFieldSize::LONG;
-    }
+    MessageTraits<OrderBookMessage>::Schema::Decode(*this, data);
 }
 
 void OrderBookMessage::Serialise(unsigned char* buf) const
 {
-    *buf = static_cast<unsigned char>(mInstrument);
-    buf += MessageFieldSize::BYTE;
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mSequenceNumber);
-    buf += MessageFieldSize::LONG;
-
-    for (auto p : mAskPrices)
-    {
-        *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)p);
-        buf += MessageFieldSize::LONG;
-    }
-    for (auto v : mAskVolumes)
-    {
-        *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)v);
-        buf += MessageFieldSize::LONG;
-    }
-    for (auto p : mBidPrices)
-    {
-        *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)p);
-        buf += MessageFieldSize::LONG;
-    }
-    for (auto v : mBidVolumes)
-    {
-        *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)v);
-        buf += MessageFieldSize::LONG;
-    }
+    MessageTraits<OrderBookMessage>::Schema::Encode(*this, buf);
+}
+
+std::size_t OrderFilledMessage::Size() const noexcept
+{
+    return MessageTraits<OrderFilledMessage>::Schema::SIZE;
 }
 
 void OrderFilledMessage::Deserialise(unsigned char const* data, std::size_t)
 {
-    mClientOrderId = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-    mPrice = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-    mVolume = boost::endian::big_to_native(*(uint32_t*)data);
+    MessageTraits<OrderFilledMessage>::Schema::Decode(*this, data);
 }
 
 void OrderFilledMessage::Serialise(unsigned char* buf) const
 {
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mClientOrderId);
-    buf += MessageFieldSize::LONG;
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mPrice);
-    buf += MessageFieldSize::LONG;
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mVolume);
+    MessageTraits<OrderFilledMessage>::Schema::Encode(*this, buf);
+}
+
+std::size_t OrderStatusMessage::Size() const noexcept
+{
+    return MessageTraits<OrderStatusMessage>::Schema::SIZE;
 }
 
 void OrderStatusMessage::Deserialise(unsigned char const* data, std::size_t)
 {
-    mClientOrderId = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-    mFillVolume = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-    mRemainingVolume = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-    mFees = boost::endian::big_to_native(*(int32_t*)data);
+    MessageTraits<OrderStatusMessage>::Schema::Decode(*this, data);
 }
 
 void OrderStatusMessage::Serialise(unsigned char* buf) const
 {
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mClientOrderId);
-    buf += MessageFieldSize::LONG;
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mFillVolume);
-    buf += MessageFieldSize::LONG;
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mRemainingVolume);
-    buf += MessageFieldSize::LONG;
-    *(int32_t*)buf = boost::endian::native_to_big((int32_t)mFees);
+    MessageTraits<OrderStatusMessage>::Schema::Encode(*this, buf);
+}
+
+std::size_t TradeTicksMessage::Size() const noexcept
+{
+    return MessageTraits<TradeTicksMessage>::Schema::SIZE;
 }
 
 void TradeTicksMessage::Deserialise(unsigned char const* data, std::size_t)
 {
-    mInstrument = Instrument(*data);
-    data += MessageFieldSize::BYTE;
-    mSequenceNumber = boost::endian::big_to_native(*(uint32_t*)data);
-    data += MessageFieldSize::LONG;
-
-    for (auto& p : mAskPrices)
-    {
-        p = boost::endian::big_to_native(*(uint32_t*)data);
-        data += MessageFieldSize::LONG;
-    }
-    for (auto& v : mAskVolumes)
-    {
-        v = boost::endian::big_to_native(*(uint32_t*)data);
-        data += MessageFieldSize::LONG;
-    }
-    for (auto& p : mBidPrices)
-    {
-        p = boost::endian::big_to_native(*(uint32_t*)data);
-        data += MessageFieldSize::LONG;
-    }
-    for (auto& v : mBidVolumes)
-    {
-        v = boost::endian::big_to_native(*(uint32_t*)data);
-        data += MessageFieldSize::LONG;
-    }
+    MessageTraits<TradeTicksMessage>::Schema::Decode(*this, data);
 }
 
 void TradeTicksMessage::Serialise(unsigned char* buf) const
 {
-    *buf = static_cast<unsigned char>(mInstrument);
-    buf += MessageFieldSize::BYTE;
-    *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)mSequenceNumber);
-    buf += MessageFieldSize::LONG;
-
-    for (auto p : mAskPrices)
-    {
-        *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)p);
-        buf += MessageFieldSize::LONG;
-    }
-    for (auto v : mAskVolumes)
-    {
-        *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)v);
-        buf += MessageFieldSize::LONG;
-    }
-    for (auto p : mBidPrices)
-    {
-        *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)p);
-        buf += MessageFieldSize::LONG;
-    }
-    for (auto v : mBidVolumes)
-    {
-        *(uint32_t*)buf = boost::endian::native_to_big((uint32_t)v);
-        buf += MessageFieldSize::LONG;
-    }
+    MessageTraits<TradeTicksMessage>::Schema::Encode(*this, buf);
 }
 
 }
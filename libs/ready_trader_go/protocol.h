@@ -20,10 +20,14 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <boost/endian/conversion.hpp>
+
+#include "codec.h"
 #include "connectivitytypes.h"
 #include "types.h"
 
@@ -44,20 +48,13 @@ enum MessageType : unsigned char
     TRADE_TICKS = 11
 };
 
-enum MessageFieldSize : std::size_t
-{
-    BYTE = 1,
-    LONG = 4,
-    STRING = 50
-};
-
 struct AmendMessage : ISerialisable
 {
     AmendMessage() = default;
     AmendMessage(unsigned long clientOrderId, unsigned long newVolume)
         : mClientOrderId(clientOrderId), mNewVolume(newVolume) {}
 
-    std::size_t Size() const noexcept override { return MessageFieldSize::LONG * 2; }
+    std::size_t Size() const noexcept override;
 
     void Deserialise(unsigned char const* data, std::size_t size) override;
     void Serialise(unsigned char* buf) const override;
@@ -71,7 +68,7 @@ struct CancelMessage : ISerialisable
     CancelMessage() = default;
     explicit CancelMessage(unsigned long clientOrderId) : mClientOrderId(clientOrderId) {}
 
-    std::size_t Size() const noexcept override { return MessageFieldSize::LONG; }
+    std::size_t Size() const noexcept override;
 
     void Deserialise(unsigned char const* data, std::size_t size) override;
     void Serialise(unsigned char* buf) const override;
@@ -85,10 +82,7 @@ struct ErrorMessage : ISerialisable
     ErrorMessage(unsigned long clientOrderId, std::string message)
         : mClientOrderId(clientOrderId), mMessage(std::move(message)) {}
 
-    std::size_t Size() const noexcept override
-    {
-        return MessageFieldSize::LONG + MessageFieldSize::STRING;
-    }
+    std::size_t Size() const noexcept override;
 
     void Deserialise(unsigned char const* data, std::size_t size) override;
     void Serialise(unsigned char* buf) const override;
@@ -109,7 +103,7 @@ struct HedgeMessage : ISerialisable
           mPrice(price),
           mVolume(volume) {}
 
-    std::size_t Size() const noexcept override { return MessageFieldSize::LONG * 3 + MessageFieldSize::BYTE; }
+    std::size_t Size() const noexcept override;
 
     void Deserialise(unsigned char const* data, std::size_t size) override;
     void Serialise(unsigned char* buf) const override;
@@ -130,7 +124,7 @@ struct HedgeFilledMessage : ISerialisable
           mPrice(price),
           mVolume(volume) {}
 
-    std::size_t Size() const noexcept override { return MessageFieldSize::LONG * 3; }
+    std::size_t Size() const noexcept override;
 
     void Deserialise(unsigned char const* data, std::size_t size) override;
     void Serialise(unsigned char* buf) const override;
@@ -154,7 +148,7 @@ struct InsertMessage : ISerialisable
           mVolume(volume),
           mLifespan(lifespan) {}
 
-    std::size_t Size() const noexcept override { return MessageFieldSize::LONG * 3 + MessageFieldSize::BYTE * 2; }
+    std::size_t Size() const noexcept override;
 
     void Deserialise(unsigned char const* data, std::size_t size) override;
     void Serialise(unsigned char* buf) const override;
@@ -172,10 +166,7 @@ struct LoginMessage : ISerialisable
     LoginMessage(std::string name, std::string secret)
         : mName(std::move(name)), mSecret(std::move(secret)) {}
 
-    std::size_t Size() const noexcept override
-    {
-        return MessageFieldSize::STRING * 2;
-    }
+    std::size_t Size() const noexcept override;
 
     void Deserialise(unsigned char const* data, std::size_t size) override;
     void Serialise(unsigned char* buf) const override;
@@ -200,12 +191,7 @@ struct OrderBookMessage : ISerialisable
           mBidPrices(bidPrices),
           mBidVolumes(bidVolumes) {}
 
-    std::size_t Size() const noexcept override
-    {
-        return MessageFieldSize::BYTE
-            + MessageFieldSize::LONG
-            + MessageFieldSize::LONG * TOP_LEVEL_COUNT * 4;
-    }
+    std::size_t Size() const noexcept override;
 
     void Deserialise(unsigned char const* data, std::size_t size) override;
     void Serialise(unsigned char* buf) const override;
@@ -228,7 +214,7 @@ struct OrderFilledMessage : ISerialisable
           mPrice(price),
           mVolume(volume) {}
 
-    std::size_t Size() const noexcept override { return MessageFieldSize::LONG * 3; }
+    std::size_t Size() const noexcept override;
 
     void Deserialise(unsigned char const* data, std::size_t size) override;
     void Serialise(unsigned char* buf) const override;
@@ -250,7 +236,7 @@ struct OrderStatusMessage : ISerialisable
           mRemainingVolume(remainingVolume),
           mFees(fees) {}
 
-    std::size_t Size() const noexcept override { return MessageFieldSize::LONG * 4; }
+    std::size_t Size() const noexcept override;
 
     void Deserialise(unsigned char const* data, std::size_t size) override;
     void Serialise(unsigned char* buf) const override;
@@ -277,12 +263,7 @@ struct TradeTicksMessage : ISerialisable
               mBidPrices(bidPrices),
               mBidVolumes(bidVolumes) {}
 
-    std::size_t Size() const noexcept override
-    {
-        return MessageFieldSize::BYTE
-               + MessageFieldSize::LONG
-               + MessageFieldSize::LONG * TOP_LEVEL_COUNT * 4;
-    }
+    std::size_t Size() const noexcept override;
 
     void Deserialise(unsigned char const* data, std::size_t size) override;
     void Serialise(unsigned char* buf) const override;
@@ -295,12 +276,164 @@ struct TradeTicksMessage : ISerialisable
     std::array<unsigned long, TOP_LEVEL_COUNT> mBidVolumes = {};
 };
 
+// Wire layout of each message. These schemas are the single definition of
+// the message formats: the ISerialisable implementations and the template
+// encoder used by IConnection::SendMessage are both generated from them.
+
+template<>
+struct MessageTraits<AmendMessage>
+{
+    static constexpr MessageType TYPE = MessageType::AMEND_ORDER;
+    using Schema = MessageSchema<Field<&AmendMessage::mClientOrderId, LongField>,
+                                 Field<&AmendMessage::mNewVolume, LongField>>;
+};
+
+template<>
+struct MessageTraits<CancelMessage>
+{
+    static constexpr MessageType TYPE = MessageType::CANCEL_ORDER;
+    using Schema = MessageSchema<Field<&CancelMessage::mClientOrderId, LongField>>;
+};
+
+template<>
+struct MessageTraits<ErrorMessage>
+{
+    static constexpr MessageType TYPE = MessageType::ERROR_MESSAGE;
+    using Schema = MessageSchema<Field<&ErrorMessage::mClientOrderId, LongField>,
+                                 Field<&ErrorMessage::mMessage, StringField>>;
+};
+
+template<>
+struct MessageTraits<HedgeMessage>
+{
+    static constexpr MessageType TYPE = MessageType::HEDGE_ORDER;
+    using Schema = MessageSchema<Field<&HedgeMessage::mClientOrderId, LongField>,
+                                 Field<&HedgeMessage::mSide, ByteField>,
+                                 Field<&HedgeMessage::mPrice, LongField>,
+                                 Field<&HedgeMessage::mVolume, LongField>>;
+};
+
+template<>
+struct MessageTraits<HedgeFilledMessage>
+{
+    static constexpr MessageType TYPE = MessageType::HEDGE_FILLED;
+    using Schema = MessageSchema<Field<&HedgeFilledMessage::mClientOrderId, LongField>,
+                                 Field<&HedgeFilledMessage::mPrice, LongField>,
+                                 Field<&HedgeFilledMessage::mVolume, LongField>>;
+};
+
+template<>
+struct MessageTraits<InsertMessage>
+{
+    static constexpr MessageType TYPE = MessageType::INSERT_ORDER;
+    using Schema = MessageSchema<Field<&InsertMessage::mClientOrderId, LongField>,
+                                 Field<&InsertMessage::mSide, ByteField>,
+                                 Field<&InsertMessage::mPrice, LongField>,
+                                 Field<&InsertMessage::mVolume, LongField>,
+                                 Field<&InsertMessage::mLifespan, ByteField>>;
+};
+
+template<>
+struct MessageTraits<LoginMessage>
+{
+    static constexpr MessageType TYPE = MessageType::LOGIN;
+    using Schema = MessageSchema<Field<&LoginMessage::mName, StringField>,
+                                 Field<&LoginMessage::mSecret, StringField>>;
+};
+
+template<>
+struct MessageTraits<OrderBookMessage>
+{
+    static constexpr MessageType TYPE = MessageType::ORDER_BOOK_UPDATE;
+    using Schema = MessageSchema<Field<&OrderBookMessage::mInstrument, ByteField>,
+                                 Field<&OrderBookMessage::mSequenceNumber, LongField>,
+                                 Field<&OrderBookMessage::mAskPrices, LevelsField>,
+                                 Field<&OrderBookMessage::mAskVolumes, LevelsField>,
+                                 Field<&OrderBookMessage::mBidPrices, LevelsField>,
+                                 Field<&OrderBookMessage::mBidVolumes, LevelsField>>;
+};
+
+template<>
+struct MessageTraits<OrderFilledMessage>
+{
+    static constexpr MessageType TYPE = MessageType::ORDER_FILLED;
+    using Schema = MessageSchema<Field<&OrderFilledMessage::mClientOrderId, LongField>,
+                                 Field<&OrderFilledMessage::mPrice, LongField>,
+                                 Field<&OrderFilledMessage::mVolume, LongField>>;
+};
+
+template<>
+struct MessageTraits<OrderStatusMessage>
+{
+    static constexpr MessageType TYPE = MessageType::ORDER_STATUS;
+    using Schema = MessageSchema<Field<&OrderStatusMessage::mClientOrderId, LongField>,
+                                 Field<&OrderStatusMessage::mFillVolume, LongField>,
+                                 Field<&OrderStatusMessage::mRemainingVolume, LongField>,
+                                 Field<&OrderStatusMessage::mFees, SignedLongField>>;
+};
+
+template<>
+struct MessageTraits<TradeTicksMessage>
+{
+    static constexpr MessageType TYPE = MessageType::TRADE_TICKS;
+    using Schema = MessageSchema<Field<&TradeTicksMessage::mInstrument, ByteField>,
+                                 Field<&TradeTicksMessage::mSequenceNumber, LongField>,
+                                 Field<&TradeTicksMessage::mAskPrices, LevelsField>,
+                                 Field<&TradeTicksMessage::mAskVolumes, LevelsField>,
+                                 Field<&TradeTicksMessage::mBidPrices, LevelsField>,
+                                 Field<&TradeTicksMessage::mBidVolumes, LevelsField>>;
+};
+
+// A read-only view over the wire representation of an order book or trade
+// ticks message. Fields are decoded from the message bytes only when they
+// are accessed, so the view must not outlive the data it was created from.
+class TopLevelsView
+{
+public:
+    TopLevelsView(unsigned char const* data, std::size_t size) : mData(data), mSize(size) {}
+
+    unsigned char const* GetData() const { return mData; }
+    std::size_t GetSize() const { return mSize; }
+
+    Instrument GetInstrument() const { return Instrument(*mData); }
+    unsigned long GetSequenceNumber() const { return ReadLong(MessageFieldSize::BYTE); }
+
+    unsigned long GetAskPrice(std::size_t level) const { return ReadLevel(0, level); }
+    unsigned long GetAskVolume(std::size_t level) const { return ReadLevel(1, level); }
+    unsigned long GetBidPrice(std::size_t level) const { return ReadLevel(2, level); }
+    unsigned long GetBidVolume(std::size_t level) const { return ReadLevel(3, level); }
+
+private:
+    static constexpr std::size_t LEVELS_OFFSET = MessageFieldSize::BYTE + MessageFieldSize::LONG;
+
+    unsigned long ReadLevel(std::size_t part, std::size_t level) const
+    {
+        return ReadLong(LEVELS_OFFSET + (part * TOP_LEVEL_COUNT + level) * MessageFieldSize::LONG);
+    }
+
+    unsigned long ReadLong(std::size_t offset) const
+    {
+        return boost::endian::big_to_native(*(uint32_t const*)(mData + offset));
+    }
+
+    unsigned char const* mData;
+    std::size_t mSize;
+};
+
+struct OrderBookView : TopLevelsView
+{
+    using TopLevelsView::TopLevelsView;
+};
+
+struct TradeTicksView : TopLevelsView
+{
+    using TopLevelsView::TopLevelsView;
+};
+
 template<class T>
-T makeMessage(unsigned char const* data, std::size_t size)
+T makeMessage(unsigned char const* data, std::size_t)
 {
-    T message;
-    message.Deserialise(data, size);
-    return message;
+    return decodeMessage<T>(data);
 }
 
 }
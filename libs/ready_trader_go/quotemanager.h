@@ -0,0 +1,235 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_QUOTEMANAGER_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_QUOTEMANAGER_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+#include "ordermanager.h"
+#include "types.h"
+
+namespace ReadyTraderGo {
+
+constexpr std::size_t MAX_QUOTES_PER_SIDE = 16;
+
+// One level of a target ladder. Levels with a zero volume are ignored.
+struct QuoteLevel
+{
+    unsigned long mPrice;
+    unsigned long mVolume;
+};
+
+// Keeps our good-for-day quotes on each side in line with a target ladder
+// using as few messages as possible.
+//
+// SetQuotes compares the target with the quotes still live and sends only
+// the difference: a cancel for each price no longer wanted, an amend down
+// where a price has too much volume (cancelling the newest orders first,
+// so the oldest keep their place in the queue) and an insert of the
+// shortfall where it has too little. A price whose volume is right costs
+// nothing, and no quote is ever cancelled just to be inserted again.
+// Cancels and amends go before inserts.
+//
+// The state of each quote is read from the Trader's order manager, so
+// quotes that fill or are cancelled drop out by themselves. An amend or
+// cancel that has been sent but not yet acknowledged is remembered, so
+// that it is not sent again. Orders the exchange's limits would refuse
+// are simply left for the next call, and nothing is sent while the
+// Trader has scheduled orders (e.g. hedges) waiting for message budget.
+//
+// Trader is a BaseAutoTraderT or a class derived from one.
+template<typename Trader>
+class QuoteManager
+{
+public:
+    explicit QuoteManager(Trader& trader) : mTrader(trader) {}
+
+    QuoteManager(const QuoteManager&) = delete;
+    QuoteManager& operator=(const QuoteManager&) = delete;
+
+    // Bring the quotes on side into line with levels and return the
+    // number of messages sent.
+    std::size_t SetQuotes(Side side, const QuoteLevel* levels, std::size_t count);
+    template<std::size_t N>
+    std::size_t SetQuotes(Side side, const std::array<QuoteLevel, N>& levels)
+    {
+        return SetQuotes(side, levels.data(), N);
+    }
+    std::size_t CancelQuotes(Side side) { return SetQuotes(side, nullptr, 0); }
+
+    // The live volume quoted at a price, net of amends and cancels sent.
+    unsigned long GetQuotedVolume(Side side, unsigned long price) const;
+
+private:
+    struct Quote
+    {
+        unsigned long mClientOrderId;
+        unsigned long mPrice;
+        unsigned long mVolume; // the remaining volume we last asked for
+        bool mIsCancelled;
+    };
+
+    struct Quotes
+    {
+        std::array<Quote, MAX_QUOTES_PER_SIDE> mQuotes;
+        std::size_t mCount = 0;
+    };
+
+    void Prune(Quotes& quotes);
+    std::size_t Reduce(Quotes& quotes, unsigned long price, unsigned long excess);
+
+    Trader& mTrader;
+    std::array<Quotes, 2> mSides;
+};
+
+template<typename Trader>
+void QuoteManager<Trader>::Prune(Quotes& quotes)
+{
+    // Drop quotes that are no longer live and pick up any fills.
+    const OrderManager& orders = mTrader.GetOrders();
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i != quotes.mCount; ++i)
+    {
+        Quote& quote = quotes.mQuotes[i];
+        const Order* order = orders.Find(quote.mClientOrderId);
+        if (order && order->mStatus == OrderStatus::LIVE)
+        {
+            quote.mVolume = std::min(quote.mVolume, order->mRemainingVolume);
+            quotes.mQuotes[kept++] = quote;
+        }
+    }
+    quotes.mCount = kept;
+}
+
+template<typename Trader>
+std::size_t QuoteManager<Trader>::Reduce(Quotes& quotes, unsigned long price, unsigned long excess)
+{
+    std::size_t sent = 0;
+    for (std::size_t i = quotes.mCount; i-- != 0 && excess != 0;)
+    {
+        Quote& quote = quotes.mQuotes[i];
+        if (quote.mIsCancelled || quote.mPrice != price)
+        {
+            continue;
+        }
+        if (quote.mVolume <= excess)
+        {
+            if (mTrader.SendCancelOrder(quote.mClientOrderId))
+            {
+                quote.mIsCancelled = true;
+                excess -= quote.mVolume;
+                ++sent;
+            }
+        }
+        else
+        {
+            // An amend sets the order's total volume, filled lots included.
+            const unsigned long fillVolume = mTrader.GetOrders().Find(quote.mClientOrderId)->mFillVolume;
+            if (mTrader.SendAmendOrder(quote.mClientOrderId, fillVolume + quote.mVolume - excess))
+            {
+                quote.mVolume -= excess;
+                excess = 0;
+                ++sent;
+            }
+        }
+    }
+    return sent;
+}
+
+template<typename Trader>
+std::size_t QuoteManager<Trader>::SetQuotes(Side side, const QuoteLevel* levels, std::size_t count)
+{
+    mTrader.ReleaseScheduledOrders();
+    if (mTrader.HasScheduledOrders())
+    {
+        return 0;
+    }
+
+    Quotes& quotes = mSides[static_cast<std::size_t>(side)];
+    Prune(quotes);
+
+    auto isWanted = [levels, count](unsigned long price) {
+        for (std::size_t i = 0; i != count; ++i)
+        {
+            if (levels[i].mPrice == price && levels[i].mVolume != 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::size_t sent = 0;
+    for (std::size_t i = 0; i != quotes.mCount; ++i)
+    {
+        Quote& quote = quotes.mQuotes[i];
+        if (!quote.mIsCancelled && !isWanted(quote.mPrice) && mTrader.SendCancelOrder(quote.mClientOrderId))
+        {
+            quote.mIsCancelled = true;
+            ++sent;
+        }
+    }
+
+    for (std::size_t i = 0; i != count; ++i)
+    {
+        const unsigned long quoted = GetQuotedVolume(side, levels[i].mPrice);
+        if (levels[i].mVolume != 0 && quoted > levels[i].mVolume)
+        {
+            sent += Reduce(quotes, levels[i].mPrice, quoted - levels[i].mVolume);
+        }
+    }
+
+    for (std::size_t i = 0; i != count; ++i)
+    {
+        const QuoteLevel& level = levels[i];
+        const unsigned long quoted = GetQuotedVolume(side, level.mPrice);
+        if (quoted < level.mVolume && quotes.mCount != MAX_QUOTES_PER_SIDE)
+        {
+            const unsigned long clientOrderId = mTrader.NextClientOrderId();
+            const unsigned long volume = level.mVolume - quoted;
+            if (mTrader.SendInsertOrder(clientOrderId, side, level.mPrice, volume, Lifespan::GOOD_FOR_DAY))
+            {
+                quotes.mQuotes[quotes.mCount++] = Quote{clientOrderId, level.mPrice, volume, false};
+                ++sent;
+            }
+        }
+    }
+    return sent;
+}
+
+template<typename Trader>
+unsigned long QuoteManager<Trader>::GetQuotedVolume(Side side, unsigned long price) const
+{
+    const Quotes& quotes = mSides[static_cast<std::size_t>(side)];
+    unsigned long volume = 0;
+    for (std::size_t i = 0; i != quotes.mCount; ++i)
+    {
+        const Quote& quote = quotes.mQuotes[i];
+        if (!quote.mIsCancelled && quote.mPrice == price)
+        {
+            volume += quote.mVolume;
+        }
+    }
+    return volume;
+}
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_QUOTEMANAGER_H
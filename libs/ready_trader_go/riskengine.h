@@ -0,0 +1,269 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_RISKENGINE_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_RISKENGINE_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+
+#include "frequencylimiter.h"
+#include "ordermanager.h"
+#include "types.h"
+
+namespace ReadyTraderGo {
+
+constexpr std::chrono::milliseconds DEFAULT_MESSAGE_FREQUENCY_MARGIN{10};
+
+// The exchange's Limits, with the exchange's defaults.
+//
+// The message frequency interval is the exchange's window in real time.
+// The exchange times messages as they arrive, so two messages sent exactly
+// one interval apart can arrive closer together if the first is delayed
+// more than the second. The frequency check therefore spaces each message
+// at least the interval plus the margin after the one limit messages
+// before it, which absorbs differences in delay of up to the margin.
+struct RiskLimits
+{
+    bool mEnabled = true;
+    std::size_t mActiveOrderCountLimit = 10;
+    unsigned long mActiveVolumeLimit = 200;
+    signed long mPositionLimit = 100;
+    std::chrono::steady_clock::duration mMessageFrequencyInterval = std::chrono::seconds(1);
+    std::chrono::steady_clock::duration mMessageFrequencyMargin = DEFAULT_MESSAGE_FREQUENCY_MARGIN;
+    std::size_t mMessageFrequencyLimit = 50;
+
+    std::chrono::steady_clock::duration GetFrequencyWindow() const
+    {
+        return mMessageFrequencyInterval + mMessageFrequencyMargin;
+    }
+};
+
+enum class RiskCheck : unsigned char
+{
+    PASSED,
+    MESSAGE_FREQUENCY_LIMIT,
+    ACTIVE_ORDER_COUNT_LIMIT,
+    ACTIVE_VOLUME_LIMIT,
+    POSITION_LIMIT,
+    AMEND_INCREASES_VOLUME,
+    ORDER_SLOT_IN_USE
+};
+
+template<typename C, typename T>
+std::basic_ostream<C, T>& operator<<(std::basic_ostream<C, T>& strm, RiskCheck check)
+{
+    static constexpr const char* NAMES[] = {"passed", "message frequency limit", "active order count limit",
+                                            "active volume limit", "position limit",
+                                            "amend would increase volume", "every order slot in use"};
+    strm << NAMES[static_cast<int>(check)];
+    return strm;
+}
+
+// Checks every order against the exchange's limits before it is sent.
+//
+// Everything the checks need is kept up to date as orders are sent and
+// as the exchange reports on them, so each check is a handful of
+// comparisons whose results are combined before a single branch. The
+// position check is against the worst case: the current position plus
+// every lot still live (or, for hedges, in flight) on the same side.
+// With checks disabled, orders are still tracked but never refused.
+//
+// Each Try function returns PASSED and records the order if it may be
+// sent, or else the limit it would breach. Cancels only count towards
+// the message frequency.
+class RiskEngine
+{
+public:
+    using Clock = FrequencyLimiter::Clock;
+
+    explicit RiskEngine(const RiskLimits& limits = RiskLimits{})
+        : mLimits(limits), mFrequency(limits.GetFrequencyWindow(), limits.mMessageFrequencyLimit) {}
+
+    RiskEngine(const RiskEngine&) = delete;
+    RiskEngine& operator=(const RiskEngine&) = delete;
+
+    // Change the limits. Messages already sent are forgotten by the
+    // frequency check, so this is meant for before trading starts.
+    void SetLimits(const RiskLimits& limits)
+    {
+        mLimits = limits;
+        mFrequency = FrequencyLimiter(limits.GetFrequencyWindow(), limits.mMessageFrequencyLimit);
+    }
+
+    RiskCheck TryAmend(unsigned long clientOrderId, unsigned long volume, Clock::time_point now);
+    RiskCheck TryCancel(unsigned long clientOrderId, Clock::time_point now);
+    RiskCheck TryHedge(unsigned long clientOrderId,
+                       Side side,
+                       unsigned long price,
+                       unsigned long volume,
+                       Clock::time_point now);
+    RiskCheck TryInsert(unsigned long clientOrderId,
+                        Side side,
+                        unsigned long price,
+                        unsigned long volume,
+                        Lifespan lifespan,
+                        Clock::time_point now);
+
+    void OnError(unsigned long clientOrderId);
+    void OnHedgeFilled(unsigned long clientOrderId, unsigned long price, unsigned long volume);
+    void OnOrderFilled(unsigned long clientOrderId, unsigned long price, unsigned long volume);
+    void OnOrderStatus(unsigned long clientOrderId,
+                       unsigned long fillVolume,
+                       unsigned long remainingVolume,
+                       signed long fees);
+
+    const RiskLimits& GetLimits() const { return mLimits; }
+    const OrderManager& GetOrders() const { return mOrders; }
+    const FrequencyLimiter& GetFrequencyLimiter() const { return mFrequency; }
+    signed long GetPosition() const { return mPosition; }
+    signed long GetHedgePosition() const { return mHedgePosition; }
+
+private:
+    static constexpr std::size_t index(Side side) { return static_cast<std::size_t>(side); }
+
+    RiskLimits mLimits;
+    OrderManager mOrders;
+    FrequencyLimiter mFrequency;
+
+    signed long mPosition = 0;
+    signed long mHedgePosition = 0;
+    std::array<unsigned long, 2> mHedgeVolume{};
+};
+
+inline RiskCheck RiskEngine::TryAmend(unsigned long clientOrderId, unsigned long volume, Clock::time_point now)
+{
+    const Order* order = mOrders.Find(clientOrderId);
+    const bool isFrequencyOk = mFrequency.IsAvailable(now);
+    const bool isVolumeOk = !order || volume <= order->mVolume;
+    if (!(isFrequencyOk & isVolumeOk) & mLimits.mEnabled)
+    {
+        return !isFrequencyOk ? RiskCheck::MESSAGE_FREQUENCY_LIMIT : RiskCheck::AMEND_INCREASES_VOLUME;
+    }
+    mFrequency.Record(now);
+    return RiskCheck::PASSED;
+}
+
+inline RiskCheck RiskEngine::TryCancel(unsigned long clientOrderId, Clock::time_point now)
+{
+    if (!mFrequency.IsAvailable(now) & mLimits.mEnabled)
+    {
+        return RiskCheck::MESSAGE_FREQUENCY_LIMIT;
+    }
+    mFrequency.Record(now);
+    return RiskCheck::PASSED;
+}
+
+inline RiskCheck RiskEngine::TryHedge(unsigned long clientOrderId,
+                                      Side side,
+                                      unsigned long price,
+                                      unsigned long volume,
+                                      Clock::time_point now)
+{
+    // The exchange limits the future position too.
+    const auto limit = mLimits.mPositionLimit;
+    const auto longest = mHedgePosition + static_cast<signed long>(mHedgeVolume[index(Side::BUY)] + volume);
+    const auto shortest = mHedgePosition - static_cast<signed long>(mHedgeVolume[index(Side::SELL)] + volume);
+    const bool isFrequencyOk = mFrequency.IsAvailable(now);
+    const bool isPositionOk = (side == Side::BUY) ? longest <= limit : shortest >= -limit;
+    if (!(isFrequencyOk & isPositionOk) & mLimits.mEnabled)
+    {
+        return !isFrequencyOk ? RiskCheck::MESSAGE_FREQUENCY_LIMIT : RiskCheck::POSITION_LIMIT;
+    }
+    if (!mOrders.Hedge(clientOrderId, side, price, volume))
+    {
+        return RiskCheck::ORDER_SLOT_IN_USE;
+    }
+    mHedgeVolume[index(side)] += volume;
+    mFrequency.Record(now);
+    return RiskCheck::PASSED;
+}
+
+inline RiskCheck RiskEngine::TryInsert(unsigned long clientOrderId,
+                                       Side side,
+                                       unsigned long price,
+                                       unsigned long volume,
+                                       Lifespan lifespan,
+                                       Clock::time_point now)
+{
+    const auto limit = mLimits.mPositionLimit;
+    const auto longest = mPosition + static_cast<signed long>(mOrders.GetActiveVolume(Side::BUY) + volume);
+    const auto shortest = mPosition - static_cast<signed long>(mOrders.GetActiveVolume(Side::SELL) + volume);
+    const bool isFrequencyOk = mFrequency.IsAvailable(now);
+    const bool isCountOk = mOrders.GetActiveCount() < mLimits.mActiveOrderCountLimit;
+    const bool isVolumeOk = mOrders.GetActiveVolume() + volume <= mLimits.mActiveVolumeLimit;
+    const bool isPositionOk = (side == Side::BUY) ? longest <= limit : shortest >= -limit;
+    if (!(isFrequencyOk & isCountOk & isVolumeOk & isPositionOk) & mLimits.mEnabled)
+    {
+        return !isFrequencyOk ? RiskCheck::MESSAGE_FREQUENCY_LIMIT
+             : !isCountOk ? RiskCheck::ACTIVE_ORDER_COUNT_LIMIT
+             : !isVolumeOk ? RiskCheck::ACTIVE_VOLUME_LIMIT
+             : RiskCheck::POSITION_LIMIT;
+    }
+    if (!mOrders.Insert(clientOrderId, side, price, volume, lifespan))
+    {
+        return RiskCheck::ORDER_SLOT_IN_USE;
+    }
+    mFrequency.Record(now);
+    return RiskCheck::PASSED;
+}
+
+inline void RiskEngine::OnError(unsigned long clientOrderId)
+{
+    // Only an error about an order the exchange hasn't acknowledged means
+    // that it rejected the order.
+    const Order* order = mOrders.ApplyError(clientOrderId);
+    if (order && order->mIsHedge)
+    {
+        mHedgeVolume[index(order->mSide)] -= order->mVolume;
+    }
+}
+
+inline void RiskEngine::OnHedgeFilled(unsigned long clientOrderId, unsigned long price, unsigned long volume)
+{
+    const Order* order = mOrders.ApplyHedgeFilled(clientOrderId, price, volume);
+    if (order)
+    {
+        mHedgeVolume[index(order->mSide)] -= order->mVolume;
+        mHedgePosition += (order->mSide == Side::BUY) ? static_cast<signed long>(volume)
+                                                      : -static_cast<signed long>(volume);
+    }
+}
+
+inline void RiskEngine::OnOrderFilled(unsigned long clientOrderId, unsigned long price, unsigned long volume)
+{
+    const Order* order = mOrders.ApplyOrderFilled(clientOrderId, price, volume);
+    if (order)
+    {
+        mPosition += (order->mSide == Side::BUY) ? static_cast<signed long>(volume)
+                                                 : -static_cast<signed long>(volume);
+    }
+}
+
+inline void RiskEngine::OnOrderStatus(unsigned long clientOrderId,
+                                      unsigned long fillVolume,
+                                      unsigned long remainingVolume,
+                                      signed long fees)
+{
+    mOrders.ApplyOrderStatus(clientOrderId, fillVolume, remainingVolume, fees);
+}
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_RISKENGINE_H
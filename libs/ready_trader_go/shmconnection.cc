@@ -0,0 +1,254 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <new>
+
+#include <boost/asio/post.hpp>
+
+#include "logging.h"
+#include "shmconnection.h"
+
+RTG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_SHM, "SHM")
+
+namespace interprocess = boost::interprocess;
+
+namespace ReadyTraderGo {
+
+static bool isPowerOfTwo(std::size_t n)
+{
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+static std::size_t ringOffset(std::size_t ringSize, ShmDirection direction)
+{
+    return sizeof(ShmChannelHeader) + direction * (sizeof(ShmRingControl) + ringSize);
+}
+
+std::size_t ShmChannel::GetFileSize(std::size_t ringSize)
+{
+    return ringOffset(ringSize, FROM_EXCHANGE) + sizeof(ShmRingControl) + ringSize;
+}
+
+ShmChannel::ShmChannel(const std::string& name) : mName(name)
+{
+    mFile = interprocess::file_mapping{name.c_str(), interprocess::read_write};
+    mRegion = interprocess::mapped_region{mFile, interprocess::read_write};
+
+    if (mRegion.get_size() < sizeof(ShmChannelHeader))
+    {
+        throw ReadyTraderGoError("'" + name + "' is too small to be an execution channel");
+    }
+
+    auto* header = static_cast<ShmChannelHeader*>(mRegion.get_address());
+    if (header->mMagic.load(std::memory_order_acquire) != SHM_CHANNEL_MAGIC)
+    {
+        throw ReadyTraderGoError("'" + name + "' is not an execution channel (or is not ready yet)");
+    }
+
+    if (header->mVersion != SHM_CHANNEL_VERSION)
+    {
+        throw ReadyTraderGoError("'" + name + "' has channel version " + std::to_string(header->mVersion)
+                                 + " but version " + std::to_string(SHM_CHANNEL_VERSION) + " is required");
+    }
+
+    mRingSize = header->mRingSize;
+    if (!isPowerOfTwo(mRingSize) || mRingSize < MINIMUM_SHM_RING_SIZE
+        || GetFileSize(mRingSize) > mRegion.get_size())
+    {
+        throw ReadyTraderGoError("'" + name + "' has an invalid ring size of " + std::to_string(mRingSize));
+    }
+}
+
+ShmChannel::ShmChannel(const std::string& name, std::size_t ringSize) : mName(name), mRingSize(ringSize)
+{
+    if (!isPowerOfTwo(ringSize) || ringSize < MINIMUM_SHM_RING_SIZE)
+    {
+        throw ReadyTraderGoError("execution channel ring size " + std::to_string(ringSize)
+                                 + " must be a power of two no smaller than "
+                                 + std::to_string(MINIMUM_SHM_RING_SIZE));
+    }
+
+    {
+        std::filebuf file;
+        if (!file.open(name, std::ios_base::in | std::ios_base::out | std::ios_base::trunc | std::ios_base::binary))
+        {
+            throw ReadyTraderGoError("unable to create execution channel '" + name + "'");
+        }
+        file.pubseekoff(GetFileSize(ringSize) - 1, std::ios_base::beg);
+        file.sputc(0);
+    }
+
+    mFile = interprocess::file_mapping{name.c_str(), interprocess::read_write};
+    mRegion = interprocess::mapped_region{mFile, interprocess::read_write};
+
+    auto* base = static_cast<unsigned char*>(mRegion.get_address());
+    auto* header = new(base) ShmChannelHeader;
+    new(base + ringOffset(ringSize, TO_EXCHANGE)) ShmRingControl;
+    new(base + ringOffset(ringSize, FROM_EXCHANGE)) ShmRingControl;
+    header->mVersion = SHM_CHANNEL_VERSION;
+    header->mRingSize = ringSize;
+
+    // Anyone opening the channel checks the magic number first, so it must
+    // be the last thing written.
+    header->mMagic.store(SHM_CHANNEL_MAGIC, std::memory_order_release);
+}
+
+ShmRing ShmChannel::GetRing(ShmDirection direction) const
+{
+    auto* control = static_cast<unsigned char*>(mRegion.get_address()) + ringOffset(mRingSize, direction);
+    return ShmRing{reinterpret_cast<ShmRingControl*>(control), control + sizeof(ShmRingControl), mRingSize};
+}
+
+ShmConnection::ShmConnection(boost::asio::io_context& context, ShmChannel&& channel)
+    : mContext(context),
+      mChannel(std::move(channel)),
+      mInbound(mChannel.GetRing(FROM_EXCHANGE)),
+      mOutbound(mChannel.GetRing(TO_EXCHANGE))
+{
+    SetName(mChannel.GetName());
+}
+
+ShmConnection::~ShmConnection()
+{
+    mOutbound.Close();
+    RLOG(LG_SHM, LogLevel::LL_INFO) << std::quoted(mName, '\'') << " closing: messages="
+                                    << mStatistics.mMessagesSent << " bytes="
+                                    << mStatistics.mBytesSent << " flushes="
+                                    << mStatistics.mFlushes << " received="
+                                    << mMessagesReceived << " polls=" << mPolls << " handler_allocations="
+                                    << mPollMemory.GetAllocations() << " heap_allocations="
+                                    << mPollMemory.GetHeapAllocations();
+}
+
+void ShmConnection::AsyncRead()
+{
+    PostPoll();
+}
+
+void ShmConnection::PostPoll()
+{
+    boost::asio::post(mContext, makeAllocatingHandler(mPollMemory, [this] { Poll(); }));
+}
+
+void ShmConnection::Poll()
+{
+    if (mIsClosed)
+    {
+        return;
+    }
+
+    ++mPolls;
+
+    // Check for closure first: anything published before the ring was
+    // closed is still delivered below.
+    const bool isRemoteClosed = mInbound.IsClosed();
+
+    std::size_t count;
+    try
+    {
+        count = mInbound.Consume([this](unsigned char const* data, std::size_t size) {
+            OnMessageReceipt(data[MESSAGE_TYPE_OFFSET], data + MESSAGE_HEADER_SIZE, size - MESSAGE_HEADER_SIZE);
+        });
+    }
+    catch (const ReadyTraderGoError& e)
+    {
+        RLOG(LG_SHM, LogLevel::LL_ERROR) << std::quoted(mName, '\'') << " " << e.what();
+        mIsClosed = true;
+        OnDisconnect();
+        return;
+    }
+
+    mMessagesReceived += count;
+    if (isRemoteClosed && count == 0)
+    {
+        RLOG(LG_SHM, LogLevel::LL_INFO) << std::quoted(mName, '\'') << " remote disconnect";
+        mIsClosed = true;
+        OnDisconnect();
+        return;
+    }
+
+    PostPoll();
+}
+
+void ShmConnection::Flush()
+{
+    if (mOutbound.HasUnpublished())
+    {
+        mOutbound.Publish();
+        mStatistics.mFlushes++;
+    }
+}
+
+unsigned char* ShmConnection::Prepare(std::size_t size)
+{
+    unsigned char* data = mOutbound.Prepare(size);
+    if (data == nullptr)
+    {
+        RLOG(LG_SHM, LogLevel::LL_ERROR) << std::quoted(mName, '\'') << " outbound ring is full";
+        throw ReadyTraderGoError("execution channel '" + mName + "' is full");
+    }
+    return data;
+}
+
+void ShmConnection::QueueMessage(std::size_t size)
+{
+    mStatistics.mMessagesSent++;
+    mStatistics.mBytesSent += size;
+
+    // Publishing is a single store, so there is nothing to be gained by
+    // deferring it for SendMode::SOON.
+    if (!IsBatching())
+    {
+        Flush();
+    }
+}
+
+void ShmConnection::SendFrame(unsigned char const* frame, std::size_t size, SendMode)
+{
+    std::memcpy(Prepare(size), frame, size);
+    mOutbound.Commit(size);
+    QueueMessage(size);
+}
+
+void ShmConnection::SendMessage(unsigned char messageType, const ISerialisable& serialisable, SendMode)
+{
+    const std::size_t size = MESSAGE_HEADER_SIZE + serialisable.Size();
+    auto* data = Prepare(size);
+    *(uint16_t*)data = boost::endian::native_to_big((uint16_t)size);
+    data[MESSAGE_TYPE_OFFSET] = messageType;
+    serialisable.Serialise(data + MESSAGE_HEADER_SIZE);
+    mOutbound.Commit(size);
+    QueueMessage(size);
+}
+
+ShmConnectionFactory::ShmConnectionFactory(boost::asio::io_context& context, std::string name)
+    : mContext(context), mName(std::move(name))
+{
+}
+
+std::unique_ptr<IConnection> ShmConnectionFactory::Create()
+{
+    ShmChannel channel{mName};
+    RLOG(LG_SHM, LogLevel::LL_INFO) << "mapped execution channel " << std::quoted(mName, '\'')
+                                    << ": ring size=" << channel.GetRing(TO_EXCHANGE).GetSize();
+    return std::make_unique<ShmConnection>(mContext, std::move(channel));
+}
+
+}
@@ -0,0 +1,266 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_SHMCONNECTION_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_SHMCONNECTION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/endian/conversion.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "buffers.h"
+#include "connectivitytypes.h"
+#include "handlermemory.h"
+#include "error.h"
+
+namespace ReadyTraderGo {
+
+// The execution channel used when the shared-memory transport is selected
+// is a file holding a header followed by two rings, one for each direction.
+// Each ring carries the same length-prefixed messages as the TCP stream,
+// so the peer at the other end can relay them to and from the exchange
+// without decoding them.
+constexpr uint32_t SHM_CHANNEL_MAGIC = 0x52544753; // "RTGS"
+constexpr uint32_t SHM_CHANNEL_VERSION = 1;
+constexpr std::size_t DEFAULT_SHM_RING_SIZE = 1 << 20;
+constexpr std::size_t MINIMUM_SHM_RING_SIZE = 1 << 17;
+
+enum ShmDirection : std::size_t
+{
+    TO_EXCHANGE = 0,
+    FROM_EXCHANGE = 1
+};
+
+// Shared positions of a ring. Each is written by one side only and lives on
+// its own cache line so that the two sides don't contend for it.
+struct ShmRingControl
+{
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> mTail{0}; // written by the producer
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> mHead{0}; // written by the consumer
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> mClosed{0}; // set by the producer
+};
+
+struct ShmChannelHeader
+{
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> mMagic{0};
+    uint32_t mVersion = 0;
+    uint64_t mRingSize = 0;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory rings need lock-free atomics");
+
+// A single-producer, single-consumer ring of messages in shared memory.
+//
+// Positions only ever increase and are reduced modulo the (power of two)
+// ring size when used. A message is always stored contiguously: when it
+// would not fit before the end of the ring, the remaining bytes are skipped
+// (marked with a zero length where there is room for one) and it is
+// written at the start instead. Each side keeps its own copy of its
+// position and only publishes it when it has finished, so a whole batch of
+// messages costs one release store on either side.
+class ShmRing
+{
+public:
+    ShmRing(ShmRingControl* control, unsigned char* data, std::size_t size)
+        : mControl(control), mData(data), mSize(size), mMask(size - 1),
+          mTail(control->mTail.load(std::memory_order_relaxed)),
+          mCachedHead(control->mHead.load(std::memory_order_relaxed)),
+          mHead(mCachedHead) {}
+
+    // Producer: return space for a message of the given size, which must be
+    // followed by a call to Commit, or nullptr if the ring is full.
+    unsigned char* Prepare(std::size_t size);
+    void Commit(std::size_t size) { mTail += size; }
+
+    // Producer: make everything committed so far visible to the consumer.
+    void Publish() { mControl->mTail.store(mTail, std::memory_order_release); }
+    bool HasUnpublished() const { return mTail != mControl->mTail.load(std::memory_order_relaxed); }
+
+    // Producer: publish and then mark the ring as finished with.
+    void Close()
+    {
+        Publish();
+        mControl->mClosed.store(1, std::memory_order_release);
+    }
+
+    // Consumer: call handler with each complete message available and
+    // return the number of messages. Throws if the ring holds a message
+    // with an impossible length.
+    template<typename F>
+    std::size_t Consume(F&& handler);
+
+    // Consumer: true if the producer will not publish anything further.
+    bool IsClosed() const { return mControl->mClosed.load(std::memory_order_acquire) != 0; }
+
+    std::size_t GetSize() const { return mSize; }
+
+private:
+    ShmRingControl* mControl;
+    unsigned char* mData;
+    std::size_t mSize;
+    std::size_t mMask;
+    uint64_t mTail;
+    uint64_t mCachedHead;
+    uint64_t mHead;
+};
+
+// The shared-memory file holding both rings of an execution channel. The
+// peer creates the file; the auto-trader opens it.
+class ShmChannel
+{
+public:
+    // Open an existing channel.
+    explicit ShmChannel(const std::string& name);
+
+    // Create (or replace) a channel with rings of the given size.
+    ShmChannel(const std::string& name, std::size_t ringSize);
+
+    ShmRing GetRing(ShmDirection direction) const;
+    const std::string& GetName() const { return mName; }
+
+    static std::size_t GetFileSize(std::size_t ringSize);
+
+private:
+    std::string mName;
+    boost::interprocess::file_mapping mFile;
+    boost::interprocess::mapped_region mRegion;
+    std::size_t mRingSize = 0;
+};
+
+// An execution connection over a shared-memory channel.
+//
+// Outbound messages are written straight into the channel's outbound ring,
+// and published with a single store per message, or per batch between
+// BeginBatch and EndBatch. The inbound ring is polled from the io_context
+// in the same way as the information subscription.
+class ShmConnection : public IConnection
+{
+public:
+    ShmConnection(boost::asio::io_context& context, ShmChannel&& channel);
+    ~ShmConnection() override;
+
+    void AsyncRead() override;
+    void Flush() override;
+    void SendFrame(unsigned char const* frame, std::size_t size, SendMode mode) override;
+    void SendMessage(unsigned char messageType, const ISerialisable& serialisable, SendMode mode) override;
+    using IConnection::SendMessage;
+
+private:
+    unsigned char* Prepare(std::size_t size);
+    void Poll();
+    void PostPoll();
+    void QueueMessage(std::size_t size);
+
+    boost::asio::io_context& mContext;
+    ShmChannel mChannel;
+    ShmRing mInbound;
+    ShmRing mOutbound;
+    bool mIsClosed = false;
+    HandlerMemory mPollMemory;
+    unsigned long mPolls = 0;
+    unsigned long mMessagesReceived = 0;
+};
+
+class ShmConnectionFactory : public IConnectionFactory
+{
+public:
+    ShmConnectionFactory(boost::asio::io_context& context, std::string name);
+
+    std::unique_ptr<IConnection> Create() override;
+
+private:
+    boost::asio::io_context& mContext;
+    std::string mName;
+};
+
+inline unsigned char* ShmRing::Prepare(std::size_t size)
+{
+    const std::size_t toEnd = mSize - (mTail & mMask);
+    const std::size_t skip = (size > toEnd) ? toEnd : 0;
+
+    if (mSize - (mTail - mCachedHead) < skip + size)
+    {
+        mCachedHead = mControl->mHead.load(std::memory_order_acquire);
+        if (mSize - (mTail - mCachedHead) < skip + size)
+        {
+            return nullptr;
+        }
+    }
+
+    if (skip != 0)
+    {
+        if (skip >= sizeof(uint16_t))
+        {
+            *(uint16_t*)(mData + (mTail & mMask)) = 0;
+        }
+        mTail += skip;
+    }
+
+    return mData + (mTail & mMask);
+}
+
+template<typename F>
+std::size_t ShmRing::Consume(F&& handler)
+{
+    const uint64_t tail = mControl->mTail.load(std::memory_order_acquire);
+    if (mHead == tail)
+    {
+        return 0;
+    }
+
+    std::size_t count = 0;
+    while (mHead != tail)
+    {
+        const std::size_t index = mHead & mMask;
+        const std::size_t toEnd = mSize - index;
+        if (toEnd < MESSAGE_HEADER_SIZE)
+        {
+            mHead += toEnd;
+            continue;
+        }
+
+        const std::size_t length = boost::endian::big_to_native(*(uint16_t*)(mData + index));
+        if (length == 0)
+        {
+            mHead += toEnd;
+            continue;
+        }
+        if (length < MESSAGE_HEADER_SIZE || length > toEnd || length > tail - mHead)
+        {
+            throw ReadyTraderGoError("shared-memory ring holds a message with invalid length "
+                                     + std::to_string(length));
+        }
+
+        handler(mData + index, length);
+        mHead += length;
+        ++count;
+    }
+
+    mControl->mHead.store(mHead, std::memory_order_release);
+    return count;
+}
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_SHMCONNECTION_H
@@ -0,0 +1,119 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_SPSCQUEUE_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "buffers.h"
+#include "error.h"
+
+namespace ReadyTraderGo {
+
+// A bounded, lock-free queue of fixed-size slots for exactly one producer
+// thread and one consumer thread.
+//
+// Slots are written and read in place: the producer fills the slot
+// returned by Prepare and makes it visible with Commit, and the consumer
+// reads the slot returned by Front and releases it with Pop. Each side
+// keeps its own index and a cached copy of the other side's, so the shared
+// indices (each on a cache line of its own) are only read when the cached
+// copy says the queue looks full or empty. The capacity must be a power
+// of two.
+template<typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(std::size_t capacity);
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer: return the next free slot, or nullptr if the queue is full.
+    T* Prepare();
+    void Commit() { mTail.store(++mProducerTail, std::memory_order_release); }
+
+    // Consumer: return the oldest committed slot, or nullptr if the queue
+    // is empty.
+    T* Front();
+    void Pop() { mHead.store(++mConsumerHead, std::memory_order_release); }
+
+    // Consumer: the number of committed slots as last seen by Front.
+    std::size_t GetDepth() const { return mConsumerCachedTail - mConsumerHead; }
+
+    std::size_t GetCapacity() const { return mCapacity; }
+
+private:
+    std::size_t mCapacity;
+    std::size_t mMask;
+    std::unique_ptr<T[]> mSlots;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mHead{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mTail{0};
+
+    alignas(CACHE_LINE_SIZE) std::size_t mProducerTail = 0;
+    std::size_t mProducerCachedHead = 0;
+
+    alignas(CACHE_LINE_SIZE) std::size_t mConsumerHead = 0;
+    std::size_t mConsumerCachedTail = 0;
+};
+
+template<typename T>
+SpscQueue<T>::SpscQueue(std::size_t capacity)
+    : mCapacity(capacity), mMask(capacity - 1), mSlots(new T[capacity])
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+    {
+        throw ReadyTraderGoError("queue capacity " + std::to_string(capacity) + " is not a power of two");
+    }
+}
+
+template<typename T>
+inline T* SpscQueue<T>::Prepare()
+{
+    if (mProducerTail - mProducerCachedHead == mCapacity)
+    {
+        mProducerCachedHead = mHead.load(std::memory_order_acquire);
+        if (mProducerTail - mProducerCachedHead == mCapacity)
+        {
+            return nullptr;
+        }
+    }
+    return &mSlots[mProducerTail & mMask];
+}
+
+template<typename T>
+inline T* SpscQueue<T>::Front()
+{
+    if (mConsumerHead == mConsumerCachedTail)
+    {
+        mConsumerCachedTail = mTail.load(std::memory_order_acquire);
+        if (mConsumerHead == mConsumerCachedTail)
+        {
+            return nullptr;
+        }
+    }
+    return &mSlots[mConsumerHead & mMask];
+}
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_SPSCQUEUE_H
@@ -0,0 +1,184 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#define RTG_HAVE_PTHREADS 1
+#endif
+
+#include "error.h"
+#include "logging.h"
+#include "threading.h"
+
+RTG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_THR, "THREAD")
+
+namespace ReadyTraderGo {
+
+#ifdef RTG_HAVE_PTHREADS
+
+static std::string errorString(int error)
+{
+    return std::strerror(error);
+}
+
+// Touch each page of the next size bytes of stack, so that the deepest
+// call chains later on don't fault in fresh stack pages.
+__attribute__((noinline)) static void prefaultStack(std::size_t size)
+{
+    const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    auto* stack = static_cast<volatile unsigned char*>(alloca(size));
+    for (std::size_t offset = 0; offset < size; offset += pageSize)
+    {
+        stack[offset] = 0;
+    }
+}
+
+static void setAffinity(int cpu, const std::string& name)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+    {
+        RLOG(LG_THR, LogLevel::LL_WARNING) << "unable to pin thread '" << name << "' to cpu " << cpu << ": "
+                                           << errorString(error);
+    }
+#else
+    RLOG(LG_THR, LogLevel::LL_WARNING) << "cpu affinity is not supported on this platform";
+#endif
+}
+
+static std::string describeAffinity()
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+    {
+        return "unknown";
+    }
+
+    std::ostringstream cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &set))
+        {
+            cpus << (cpus.tellp() > 0 ? "," : "") << cpu;
+        }
+    }
+    return cpus.str();
+#else
+    return "any";
+#endif
+}
+
+void configureCurrentThread(const ThreadSettings& settings, const std::string& name)
+{
+    const long cpuCount = sysconf(_SC_NPROCESSORS_CONF);
+    if (settings.mCpu < -1 || settings.mCpu >= cpuCount)
+    {
+        throw ReadyTraderGoError("configured cpu " + std::to_string(settings.mCpu) + " for thread '" + name
+                                 + "' is not between -1 and " + std::to_string(cpuCount - 1));
+    }
+
+    const int minPriority = sched_get_priority_min(SCHED_FIFO);
+    const int maxPriority = sched_get_priority_max(SCHED_FIFO);
+    if (settings.mPriority != 0 && (settings.mPriority < minPriority || settings.mPriority > maxPriority))
+    {
+        throw ReadyTraderGoError("configured priority " + std::to_string(settings.mPriority) + " for thread '"
+                                 + name + "' is not zero or between " + std::to_string(minPriority) + " and "
+                                 + std::to_string(maxPriority));
+    }
+
+    rlimit stackLimit{};
+    getrlimit(RLIMIT_STACK, &stackLimit);
+    if (stackLimit.rlim_cur != RLIM_INFINITY && settings.mStackPrefault > stackLimit.rlim_cur / 2)
+    {
+        throw ReadyTraderGoError("configured stack prefault of " + std::to_string(settings.mStackPrefault)
+                                 + " bytes is more than half the stack size limit");
+    }
+
+    // Pin first, so that everything below happens on the CPU the thread
+    // will stay on.
+    if (settings.mCpu >= 0)
+    {
+        setAffinity(settings.mCpu, name);
+    }
+
+    bool isLocked = false;
+    if (settings.mLockMemory)
+    {
+        isLocked = (mlockall(MCL_CURRENT | MCL_FUTURE) == 0);
+        if (!isLocked)
+        {
+            RLOG(LG_THR, LogLevel::LL_WARNING) << "unable to lock memory for thread '" << name << "': "
+                                               << errorString(errno) << " (check the locked memory limit)";
+        }
+    }
+
+    if (settings.mStackPrefault != 0)
+    {
+        prefaultStack(settings.mStackPrefault);
+    }
+
+    if (settings.mPriority != 0)
+    {
+        sched_param param{};
+        param.sched_priority = settings.mPriority;
+        if (int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param))
+        {
+            RLOG(LG_THR, LogLevel::LL_WARNING) << "unable to give thread '" << name << "' SCHED_FIFO priority "
+                                               << settings.mPriority << ": " << errorString(error);
+        }
+    }
+
+    int policy = SCHED_OTHER;
+    sched_param param{};
+    pthread_getschedparam(pthread_self(), &policy, &param);
+
+    RLOG(LG_THR, LogLevel::LL_INFO) << "thread '" << name << "' running with cpus=" << describeAffinity()
+                                    << " policy=" << (policy == SCHED_FIFO ? "fifo" : policy == SCHED_RR ? "rr" : "other")
+                                    << " priority=" << param.sched_priority << " memory_locked="
+                                    << std::boolalpha << isLocked << " stack_prefault="
+                                    << settings.mStackPrefault;
+}
+
+#else
+
+void configureCurrentThread(const ThreadSettings& settings, const std::string& name)
+{
+    if (settings.mCpu != -1 || settings.mPriority != 0 || settings.mLockMemory || settings.mStackPrefault != 0)
+    {
+        RLOG(LG_THR, LogLevel::LL_WARNING) << "thread settings for '" << name
+                                           << "' are not supported on this platform and have been ignored";
+    }
+}
+
+#endif
+
+}
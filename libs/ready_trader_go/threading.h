@@ -0,0 +1,54 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_THREADING_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_THREADING_H
+
+#include <cstddef>
+#include <string>
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace ReadyTraderGo {
+
+// How a latency-sensitive thread should be run. The defaults leave
+// everything to the operating system.
+struct ThreadSettings
+{
+    void readFromPropertyTree(const boost::property_tree::ptree& tree, const std::string& section)
+    {
+        mCpu = tree.get<int>(section + ".Cpu", -1);
+        mPriority = tree.get<int>(section + ".Priority", 0);
+        mLockMemory = tree.get<bool>(section + ".LockMemory", false);
+        mStackPrefault = tree.get<std::size_t>(section + ".StackPrefault", 0);
+    }
+
+    int mCpu = -1; // the only CPU the thread may run on, or -1 for any
+    int mPriority = 0; // SCHED_FIFO priority, or 0 for the normal scheduler
+    bool mLockMemory = false; // lock all current and future pages of the process
+    std::size_t mStackPrefault = 0; // bytes of stack to touch up front
+};
+
+// Apply the given settings to the calling thread and log the settings
+// that are actually in effect afterwards. Settings that are invalid throw;
+// those the system refuses (e.g. for lack of privilege) are logged as
+// warnings, so the thread keeps running with whatever it has.
+void configureCurrentThread(const ThreadSettings& settings, const std::string& name);
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_THREADING_H
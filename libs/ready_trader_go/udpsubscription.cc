@@ -0,0 +1,350 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <string>
+
+#include <boost/asio/ip/multicast.hpp>
+#include <boost/system/system_error.hpp>
+
+#include "error.h"
+#include "logging.h"
+#include "udpsubscription.h"
+
+namespace error = boost::asio::error;
+namespace ip = boost::asio::ip;
+using boost::asio::ip::udp;
+
+RTG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_UDP, "UDP")
+
+namespace ReadyTraderGo {
+
+#ifdef __linux__
+static const std::size_t CONTROL_SIZE = CMSG_SPACE(sizeof(timespec));
+#endif
+
+UdpSubscription::UdpSubscription(boost::asio::io_context& context,
+                                 udp::socket&& socket,
+                                 const SubscriptionSettings& settings)
+    : mContext(context),
+      mSocket(std::move(socket)),
+      mSettings(settings),
+      mDatagrams(settings.mMaxBatch * MAXIMUM_DATAGRAM_SIZE)
+{
+#ifdef __linux__
+    mHeaders.resize(settings.mMaxBatch);
+    mIovecs.resize(settings.mMaxBatch);
+    mControl.resize(settings.mMaxBatch * CONTROL_SIZE);
+    for (std::size_t i = 0; i < settings.mMaxBatch; ++i)
+    {
+        mIovecs[i].iov_base = mDatagrams.Get() + i * MAXIMUM_DATAGRAM_SIZE;
+        mIovecs[i].iov_len = MAXIMUM_DATAGRAM_SIZE;
+        mHeaders[i].msg_hdr = msghdr{};
+        mHeaders[i].msg_hdr.msg_iov = &mIovecs[i];
+        mHeaders[i].msg_hdr.msg_iovlen = 1;
+        if (settings.mTimestamps)
+        {
+            mHeaders[i].msg_hdr.msg_control = mControl.data() + i * CONTROL_SIZE;
+        }
+    }
+#endif
+}
+
+UdpSubscription::~UdpSubscription()
+{
+    RLOG(LG_UDP, LogLevel::LL_INFO) << std::quoted(mName, '\'') << " closing: datagrams="
+                                    << mStatistics.mFramesReceived << " batches="
+                                    << mStatistics.mBatches << " empty_polls="
+                                    << mStatistics.mEmptyPolls << " truncated="
+                                    << mStatistics.mTruncated << " sequence_gaps="
+                                    << mStatistics.mSequenceGaps << " messages_missed="
+                                    << mStatistics.mMessagesMissed << " avg_delay_ns="
+                                    << (mTimestamped ? mTotalDelay / mTimestamped : 0)
+                                    << " max_delay_ns=" << mMaxDelay << " handler_allocations="
+                                    << mWaitMemory.GetAllocations() << " heap_allocations="
+                                    << mWaitMemory.GetHeapAllocations();
+}
+
+void UdpSubscription::AsyncReceive()
+{
+    if (!mSettings.mIsPolledExternally)
+    {
+        AsyncWait(shared_from_this());
+    }
+}
+
+std::size_t UdpSubscription::Poll()
+{
+    return Receive();
+}
+
+void UdpSubscription::AsyncWait(std::weak_ptr<ISubscription> weak_this)
+{
+    auto handler = [this, weak_this](const boost::system::error_code& error) {
+        if (weak_this.expired() || error == error::operation_aborted)
+        {
+            return;
+        }
+
+        if (error)
+        {
+            RLOG(LG_UDP, LogLevel::LL_ERROR) << std::quoted(mName, '\'') << " wait failed: " << error.message();
+            return;
+        }
+
+        // Drain everything that has arrived before waiting again.
+        while (Receive() == mSettings.mMaxBatch)
+            ;
+
+        AsyncWait(weak_this);
+    };
+    mSocket.async_wait(udp::socket::wait_read, makeAllocatingHandler(mWaitMemory, std::move(handler)));
+}
+
+#ifdef __linux__
+
+std::size_t UdpSubscription::Receive()
+{
+    const auto count = static_cast<unsigned int>(mHeaders.size());
+    for (auto& header : mHeaders)
+    {
+        header.msg_hdr.msg_controllen = mSettings.mTimestamps ? CONTROL_SIZE : 0;
+        header.msg_hdr.msg_flags = 0;
+    }
+
+    const int received = recvmmsg(mSocket.native_handle(), mHeaders.data(), count, MSG_DONTWAIT, nullptr);
+    if (received < 0)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            RLOG(LG_UDP, LogLevel::LL_ERROR) << std::quoted(mName, '\'') << " receive failed: "
+                                             << std::strerror(errno);
+        }
+        ++mStatistics.mEmptyPolls;
+        return 0;
+    }
+
+    timespec now{};
+    if (mSettings.mTimestamps)
+    {
+        clock_gettime(CLOCK_REALTIME, &now);
+    }
+
+    for (int i = 0; i < received; ++i)
+    {
+        const msghdr& header = mHeaders[i].msg_hdr;
+        if (mSettings.mTimestamps)
+        {
+            RecordDelay(header, now);
+        }
+        ReceiveDatagram(static_cast<unsigned char const*>(mIovecs[i].iov_base), mHeaders[i].msg_len,
+                        (header.msg_flags & MSG_TRUNC) != 0);
+    }
+
+    mStatistics.mFramesReceived += received;
+    ++mStatistics.mBatches;
+
+    return received;
+}
+
+void UdpSubscription::RecordDelay(const msghdr& header, const timespec& now)
+{
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr; cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&header), cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            timespec arrived;
+            std::memcpy(&arrived, CMSG_DATA(cmsg), sizeof(arrived));
+            const long long delay = (now.tv_sec - arrived.tv_sec) * 1000000000LL + (now.tv_nsec - arrived.tv_nsec);
+            const unsigned long long clamped = (delay > 0) ? delay : 0;
+            mTotalDelay += clamped;
+            if (clamped > mMaxDelay)
+            {
+                mMaxDelay = clamped;
+            }
+            ++mTimestamped;
+            return;
+        }
+    }
+}
+
+#else
+
+std::size_t UdpSubscription::Receive()
+{
+    std::size_t count = 0;
+    while (count < mSettings.mMaxBatch)
+    {
+        boost::system::error_code error;
+        const std::size_t size = mSocket.receive(boost::asio::buffer(mDatagrams.Get(), MAXIMUM_DATAGRAM_SIZE), 0, error);
+        if (error && error != error::message_size)
+        {
+            if (error != error::would_block && error != error::try_again)
+            {
+                RLOG(LG_UDP, LogLevel::LL_ERROR) << std::quoted(mName, '\'') << " receive failed: " << error.message();
+            }
+            break;
+        }
+        ReceiveDatagram(mDatagrams.Get(), size, error == error::message_size);
+        ++count;
+    }
+
+    if (count == 0)
+    {
+        ++mStatistics.mEmptyPolls;
+        return 0;
+    }
+
+    mStatistics.mFramesReceived += count;
+    ++mStatistics.mBatches;
+    return count;
+}
+
+#endif
+
+void UdpSubscription::ReceiveDatagram(unsigned char const* data, std::size_t size, bool isTruncated)
+{
+    if (isTruncated)
+    {
+        ++mStatistics.mTruncated;
+        RLOG(LG_UDP, LogLevel::LL_ERROR) << std::quoted(mName, '\'') << " discarded a datagram longer than "
+                                         << MAXIMUM_DATAGRAM_SIZE << " bytes";
+        return;
+    }
+
+    ReceiveFromHandler(data, size);
+}
+
+UdpSubscriptionFactory::UdpSubscriptionFactory(boost::asio::io_context& context,
+                                               const std::string& name,
+                                               const SubscriptionSettings& settings)
+    : mContext(context), mName(name), mSettings(settings)
+{
+    const auto colon = name.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == name.size())
+    {
+        throw ReadyTraderGoError("information name '" + name + "' is not of the form address:port");
+    }
+
+    std::string host = name.substr(0, colon);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']')
+    {
+        host = host.substr(1, host.size() - 2);
+    }
+
+    boost::system::error_code error;
+    const auto address = ip::make_address(host, error);
+    if (error)
+    {
+        throw ReadyTraderGoError("information address '" + host + "' is invalid: " + error.message());
+    }
+
+    unsigned long port = 0;
+    try
+    {
+        port = std::stoul(name.substr(colon + 1));
+    }
+    catch (const std::exception&)
+    {
+    }
+    if (port == 0 || port > 65535)
+    {
+        throw ReadyTraderGoError("information port in '" + name + "' is invalid");
+    }
+
+    mEndpoint = udp::endpoint(address, static_cast<unsigned short>(port));
+}
+
+std::shared_ptr<ISubscription> UdpSubscriptionFactory::Create()
+{
+    udp::socket socket{mContext};
+    SubscriptionSettings settings = mSettings;
+
+    try
+    {
+        socket.open(mEndpoint.protocol());
+
+        const auto address = mEndpoint.address();
+        if (address.is_multicast())
+        {
+            // Several subscribers on one host may join the same group.
+            socket.set_option(udp::socket::reuse_address(true));
+            socket.bind(udp::endpoint(mEndpoint.protocol(), mEndpoint.port()));
+            if (settings.mInterface.empty() || address.is_v6())
+            {
+                socket.set_option(ip::multicast::join_group(address));
+            }
+            else
+            {
+                socket.set_option(ip::multicast::join_group(address.to_v4(),
+                                                            ip::make_address_v4(settings.mInterface)));
+            }
+        }
+        else
+        {
+            socket.bind(mEndpoint);
+        }
+
+        if (settings.mReceiveBufferSize != 0)
+        {
+            socket.set_option(udp::socket::receive_buffer_size(static_cast<int>(settings.mReceiveBufferSize)));
+        }
+
+        socket.non_blocking(true);
+    }
+    catch (const boost::system::system_error& e)
+    {
+        throw ReadyTraderGoError("unable to subscribe to '" + mName + "': " + e.code().message());
+    }
+
+    udp::socket::receive_buffer_size receiveBufferSize;
+    socket.get_option(receiveBufferSize);
+    if (static_cast<std::size_t>(receiveBufferSize.value()) < settings.mReceiveBufferSize)
+    {
+        RLOG(LG_UDP, LogLevel::LL_WARNING) << "receive buffer for " << std::quoted(mName, '\'')
+                                           << " limited to " << receiveBufferSize.value()
+                                           << " bytes (requested " << settings.mReceiveBufferSize << ")";
+    }
+
+#ifdef __linux__
+    if (settings.mTimestamps)
+    {
+        const int on = 1;
+        if (setsockopt(socket.native_handle(), SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) != 0)
+        {
+            RLOG(LG_UDP, LogLevel::LL_WARNING) << "kernel timestamps unavailable for " << std::quoted(mName, '\'')
+                                               << ": " << std::strerror(errno);
+            settings.mTimestamps = false;
+        }
+    }
+#else
+    settings.mTimestamps = false;
+#endif
+
+    RLOG(LG_UDP, LogLevel::LL_INFO) << "subscribed to " << std::quoted(mName, '\'') << ": receive buffer="
+                                    << receiveBufferSize.value() << " max batch=" << settings.mMaxBatch
+                                    << " timestamps=" << std::boolalpha << settings.mTimestamps;
+
+    auto subscription = std::make_shared<UdpSubscription>(mContext, std::move(socket), settings);
+    subscription->SetName(mName);
+    return subscription;
+}
+
+}
@@ -0,0 +1,107 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_UDPSUBSCRIPTION_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_UDPSUBSCRIPTION_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/system/error_code.hpp>
+
+#include "buffers.h"
+#include "connectivity.h"
+#include "connectivitytypes.h"
+#include "handlermemory.h"
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+namespace ReadyTraderGo {
+
+// Room for each datagram. Anything longer is truncated and discarded.
+constexpr std::size_t MAXIMUM_DATAGRAM_SIZE = 512;
+
+// An information subscription that receives one message per datagram from
+// a UDP socket, either bound to a unicast address or joined to a multicast
+// group.
+//
+// The socket is watched by the io_context and, once readable, drained with
+// recvmmsg in batches of up to MaxBatch datagrams. When timestamps are
+// enabled the kernel records when each datagram arrived, which gives the
+// delay between arrival and delivery to the auto-trader.
+class UdpSubscription : public MessageSubscription
+{
+public:
+    UdpSubscription(boost::asio::io_context& context,
+                    boost::asio::ip::udp::socket&& socket,
+                    const SubscriptionSettings& settings);
+    ~UdpSubscription() override;
+    void AsyncReceive() override;
+    std::size_t Poll() override;
+
+private:
+    void AsyncWait(std::weak_ptr<ISubscription> weak_this);
+    std::size_t Receive();
+    void ReceiveDatagram(unsigned char const* data, std::size_t size, bool isTruncated);
+
+    boost::asio::io_context& mContext;
+    boost::asio::ip::udp::socket mSocket;
+    SubscriptionSettings mSettings;
+    AlignedStorage mDatagrams;
+    HandlerMemory mWaitMemory;
+
+#ifdef __linux__
+    void RecordDelay(const msghdr& header, const timespec& now);
+
+    std::vector<mmsghdr> mHeaders;
+    std::vector<iovec> mIovecs;
+    std::vector<unsigned char> mControl;
+#endif
+
+    unsigned long mTimestamped = 0;
+    unsigned long long mTotalDelay = 0; // nanoseconds
+    unsigned long long mMaxDelay = 0; // nanoseconds
+};
+
+// Creates UDP subscriptions. The name is the address to receive on, as
+// "address:port"; a multicast address means join that group.
+class UdpSubscriptionFactory : public ISubscriptionFactory
+{
+public:
+    UdpSubscriptionFactory(boost::asio::io_context& context,
+                           const std::string& name,
+                           const SubscriptionSettings& settings);
+
+    std::shared_ptr<ISubscription> Create() override;
+
+private:
+    boost::asio::io_context& mContext;
+    std::string mName;
+    boost::asio::ip::udp::endpoint mEndpoint;
+    SubscriptionSettings mSettings;
+};
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_UDPSUBSCRIPTION_H
@@ -0,0 +1,598 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <string>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
+
+#include "error.h"
+#include "logging.h"
+#include "uringconnection.h"
+
+#ifdef RTG_HAVE_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+RTG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_URING, "URING")
+
+namespace ReadyTraderGo {
+
+static bool isPowerOfTwo(std::size_t n)
+{
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+#ifdef RTG_HAVE_IO_URING
+
+constexpr unsigned short RECEIVE_BUFFER_GROUP = 0;
+
+// Identifies the operation a completion belongs to.
+enum UringOperation : unsigned long long
+{
+    RECEIVE = 1,
+    WRITE = 2
+};
+
+static std::string errorString(int error)
+{
+    return std::strerror(error);
+}
+
+IoUring::IoUring(unsigned int entries, bool sqPoll, unsigned int sqPollIdle)
+{
+    if (sqPoll)
+    {
+        mParams.flags |= IORING_SETUP_SQPOLL;
+        mParams.sq_thread_idle = sqPollIdle;
+    }
+
+    mFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &mParams));
+    if (mFd < 0)
+    {
+        throw ReadyTraderGoError("io_uring_setup failed: " + errorString(errno));
+    }
+
+    mSqRingSize = mParams.sq_off.array + mParams.sq_entries * sizeof(unsigned int);
+    mCqRingSize = mParams.cq_off.cqes + mParams.cq_entries * sizeof(io_uring_cqe);
+    if (mParams.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        mSqRingSize = mCqRingSize = std::max(mSqRingSize, mCqRingSize);
+    }
+
+    mSqRing = mmap(nullptr, mSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd,
+                   IORING_OFF_SQ_RING);
+    if (mSqRing == MAP_FAILED)
+    {
+        mSqRing = nullptr;
+        const int error = errno;
+        Release();
+        throw ReadyTraderGoError("failed to map io_uring submission queue: " + errorString(error));
+    }
+
+    if (mParams.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        mCqRing = mSqRing;
+    }
+    else
+    {
+        mCqRing = mmap(nullptr, mCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd,
+                       IORING_OFF_CQ_RING);
+        if (mCqRing == MAP_FAILED)
+        {
+            mCqRing = nullptr;
+            const int error = errno;
+            Release();
+            throw ReadyTraderGoError("failed to map io_uring completion queue: " + errorString(error));
+        }
+    }
+
+    mSqesSize = mParams.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, mSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd,
+                      IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        const int error = errno;
+        Release();
+        throw ReadyTraderGoError("failed to map io_uring submission entries: " + errorString(error));
+    }
+    mSqes = static_cast<io_uring_sqe*>(sqes);
+
+    auto* sq = static_cast<unsigned char*>(mSqRing);
+    mSqHead = reinterpret_cast<unsigned int*>(sq + mParams.sq_off.head);
+    mSqTail = reinterpret_cast<unsigned int*>(sq + mParams.sq_off.tail);
+    mSqFlags = reinterpret_cast<unsigned int*>(sq + mParams.sq_off.flags);
+    mSqArray = reinterpret_cast<unsigned int*>(sq + mParams.sq_off.array);
+    mSqMask = *reinterpret_cast<unsigned int*>(sq + mParams.sq_off.ring_mask);
+    mSqLocalTail = mSqSubmitted = *mSqTail;
+
+    auto* cq = static_cast<unsigned char*>(mCqRing);
+    mCqHead = reinterpret_cast<unsigned int*>(cq + mParams.cq_off.head);
+    mCqTail = reinterpret_cast<unsigned int*>(cq + mParams.cq_off.tail);
+    mCqes = reinterpret_cast<io_uring_cqe*>(cq + mParams.cq_off.cqes);
+    mCqMask = *reinterpret_cast<unsigned int*>(cq + mParams.cq_off.ring_mask);
+}
+
+IoUring::~IoUring()
+{
+    Release();
+}
+
+void IoUring::Release()
+{
+    if (mFd >= 0)
+    {
+        close(mFd);
+        mFd = -1;
+    }
+    if (mBufferRing)
+    {
+        munmap(mBufferRing, mBufferRingSize);
+        mBufferRing = nullptr;
+    }
+    if (mSqes)
+    {
+        munmap(mSqes, mSqesSize);
+        mSqes = nullptr;
+    }
+    if (mCqRing && mCqRing != mSqRing)
+    {
+        munmap(mCqRing, mCqRingSize);
+    }
+    mCqRing = nullptr;
+    if (mSqRing)
+    {
+        munmap(mSqRing, mSqRingSize);
+        mSqRing = nullptr;
+    }
+}
+
+io_uring_sqe* IoUring::GetSqe()
+{
+    const unsigned int head = __atomic_load_n(mSqHead, __ATOMIC_ACQUIRE);
+    if (mSqLocalTail - head >= mParams.sq_entries)
+    {
+        return nullptr;
+    }
+
+    const unsigned int index = mSqLocalTail & mSqMask;
+    mSqArray[index] = index;
+    mSqLocalTail++;
+
+    io_uring_sqe* sqe = &mSqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+void IoUring::Submit()
+{
+    const unsigned int toSubmit = mSqLocalTail - mSqSubmitted;
+    mSqSubmitted = mSqLocalTail;
+    __atomic_store_n(mSqTail, mSqLocalTail, __ATOMIC_RELEASE);
+
+    if (mParams.flags & IORING_SETUP_SQPOLL)
+    {
+        // The kernel thread only needs waking if it has gone idle.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (__atomic_load_n(mSqFlags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP)
+        {
+            Enter(0, IORING_ENTER_SQ_WAKEUP);
+        }
+    }
+    else if (toSubmit > 0)
+    {
+        Enter(toSubmit, 0);
+    }
+}
+
+int IoUring::Enter(unsigned int toSubmit, unsigned int flags)
+{
+    mEnterCalls++;
+    const int result = static_cast<int>(syscall(__NR_io_uring_enter, mFd, toSubmit, 0, flags, nullptr, 0));
+    if (result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+    {
+        throw ReadyTraderGoError("io_uring_enter failed: " + errorString(errno));
+    }
+    return result;
+}
+
+void IoUring::RegisterBuffers(const iovec* buffers, unsigned int count)
+{
+    if (syscall(__NR_io_uring_register, mFd, IORING_REGISTER_BUFFERS, buffers, count) < 0)
+    {
+        throw ReadyTraderGoError("failed to register io_uring buffers: " + errorString(errno));
+    }
+}
+
+io_uring_buf_ring* IoUring::RegisterBufferRing(unsigned int entries, unsigned short group)
+{
+    mBufferRingSize = entries * sizeof(io_uring_buf);
+    mBufferRing = mmap(nullptr, mBufferRingSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (mBufferRing == MAP_FAILED)
+    {
+        mBufferRing = nullptr;
+        throw ReadyTraderGoError("failed to allocate io_uring buffer ring: " + errorString(errno));
+    }
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<unsigned long long>(mBufferRing);
+    reg.ring_entries = entries;
+    reg.bgid = group;
+    if (syscall(__NR_io_uring_register, mFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        throw ReadyTraderGoError("failed to register io_uring buffer ring: " + errorString(errno));
+    }
+
+    return static_cast<io_uring_buf_ring*>(mBufferRing);
+}
+
+void IoUring::ProvideBuffer(io_uring_buf_ring* ring, unsigned int entries, void* addr, unsigned int len,
+                            unsigned short bid)
+{
+    // The kernel header's flexible bufs array is offset by its empty
+    // placeholder member when compiled as C++, so index the ring directly.
+    const unsigned short tail = ring->tail;
+    io_uring_buf* buf = reinterpret_cast<io_uring_buf*>(ring) + (tail & (entries - 1));
+    buf->addr = reinterpret_cast<unsigned long long>(addr);
+    buf->len = len;
+    buf->bid = bid;
+    __atomic_store_n(&ring->tail, static_cast<unsigned short>(tail + 1), __ATOMIC_RELEASE);
+}
+
+UringConnection::UringConnection(boost::asio::io_context& context,
+                                 tcp::socket&& socket,
+                                 const UringSettings& settings)
+    : mContext(context),
+      mSocket(std::move(socket)),
+      mSettings(settings),
+      mReceiveBuffers(settings.mReceiveBufferCount * settings.mReceiveBufferSize),
+      mInBuffer(RECEIVE_BUFFER_SIZE, MAXIMUM_MESSAGE_SIZE),
+      mOutBuffer(SEND_BUFFER_SIZE),
+      mRing(settings.mEntries, settings.mSqPoll, settings.mSqPollIdle),
+      mRingDescriptor(context, mRing.GetFd())
+{
+    SetName('\'' + std::to_string(mSocket.local_endpoint().port()) + '\'');
+
+    // Operations on the socket are now performed by the kernel on our
+    // behalf, which is simplest when it is in blocking mode.
+    mSocket.non_blocking(false);
+
+    const iovec sendBuffer{mOutBuffer.GetStorage().Get(), mOutBuffer.GetStorage().GetCapacity()};
+    mRing.RegisterBuffers(&sendBuffer, 1);
+
+    mBufferRing = mRing.RegisterBufferRing(mSettings.mReceiveBufferCount, RECEIVE_BUFFER_GROUP);
+    for (unsigned int i = 0; i < mSettings.mReceiveBufferCount; ++i)
+    {
+        mRing.ProvideBuffer(mBufferRing, mSettings.mReceiveBufferCount,
+                            mReceiveBuffers.Get() + i * mSettings.mReceiveBufferSize,
+                            mSettings.mReceiveBufferSize, i);
+    }
+
+    RLOG(LG_URING, LogLevel::LL_INFO) << std::quoted(mName, '\'') << " using io_uring: entries=" << mSettings.mEntries
+                                      << " sqpoll=" << mSettings.mSqPoll << " receive buffers="
+                                      << mSettings.mReceiveBufferCount << 'x' << mSettings.mReceiveBufferSize;
+
+    AsyncWaitForCompletions();
+}
+
+UringConnection::~UringConnection()
+{
+    RLOG(LG_URING, LogLevel::LL_INFO) << std::quoted(mName, '\'') << " closing: messages="
+                                      << mStatistics.mMessagesSent << " bytes=" << mStatistics.mBytesSent
+                                      << " flushes=" << mStatistics.mFlushes
+                                      << " writes=" << mStatistics.mAsyncWrites
+                                      << " receives=" << mReceiveCompletions
+                                      << " enter_calls=" << mRing.GetEnterCalls()
+                                      << " max_pending=" << mStatistics.mMaxPending
+                                      << " handler_allocations="
+                                      << mWaitMemory.GetAllocations() + mSendMemory.GetAllocations()
+                                      << " heap_allocations="
+                                      << mWaitMemory.GetHeapAllocations() + mSendMemory.GetHeapAllocations();
+
+    mIsClosed = true;
+
+    // The ring belongs to mRing, not the descriptor.
+    mRingDescriptor.release();
+
+    if (mSocket.is_open())
+    {
+        boost::system::error_code error;
+        mSocket.shutdown(tcp::socket::shutdown_both, error);
+        mSocket.close(error);
+    }
+}
+
+void UringConnection::AsyncRead()
+{
+    if (!mIsReceiving && !mIsClosed)
+    {
+        SubmitReceive();
+    }
+}
+
+void UringConnection::AsyncWaitForCompletions()
+{
+    mRingDescriptor.async_wait(boost::asio::posix::stream_descriptor::wait_read,
+                               makeAllocatingHandler(mWaitMemory, [this](auto& error) { CompletionHandler(error); }));
+}
+
+void UringConnection::CompletionHandler(const boost::system::error_code& error)
+{
+    if (error)
+    {
+        if (error != boost::asio::error::operation_aborted)
+        {
+            RLOG(LG_URING, LogLevel::LL_ERROR) << std::quoted(mName, '\'') << " wait failed: " << error.message();
+            mIsClosed = true;
+            OnDisconnect();
+        }
+        return;
+    }
+
+    // Wait again before reaping so that no completion can slip by unnoticed.
+    AsyncWaitForCompletions();
+
+    mRing.ReapCompletions([this](const io_uring_cqe& cqe) {
+        if (mIsClosed)
+        {
+            return;
+        }
+        if (cqe.user_data == UringOperation::RECEIVE)
+        {
+            ReceiveCompletion(cqe.res, cqe.flags);
+        }
+        else if (cqe.user_data == UringOperation::WRITE)
+        {
+            WriteCompletion(cqe.res);
+        }
+    });
+}
+
+void UringConnection::Flush()
+{
+    if (!mOutBuffer.IsWriting() && mOutBuffer.GetSize() > 0)
+    {
+        mStatistics.mFlushes++;
+        SubmitWrite();
+    }
+}
+
+void UringConnection::QueueMessage(SendMode mode)
+{
+    mStatistics.mMessagesSent++;
+    const std::size_t pending = mOutBuffer.GetSize() + mOutBuffer.GetOverflowSize();
+    if (pending > mStatistics.mMaxPending)
+    {
+        mStatistics.mMaxPending = pending;
+    }
+
+    if (IsBatching() || mOutBuffer.IsWriting())
+    {
+        return;
+    }
+
+    if (mode == SendMode::ASAP)
+    {
+        Flush();
+    }
+    else if (!mIsSendPosted)
+    {
+        boost::asio::post(mContext, makeAllocatingHandler(mSendMemory, [this] {
+            mIsSendPosted = false;
+            Flush();
+        }));
+        mIsSendPosted = true;
+    }
+}
+
+void UringConnection::Receive(unsigned char const* data, std::size_t size)
+{
+    std::size_t consumed;
+
+    if (mInBuffer.GetSize() == 0)
+    {
+        // Nothing left over from before, so parse straight out of the
+        // kernel's buffer and keep only the start of any partial message.
+        consumed = DeliverMessages(data, size);
+        if (consumed != INVALID_MESSAGE && consumed < size)
+        {
+            std::memcpy(mInBuffer.GetWritePointer(), data + consumed, size - consumed);
+            mInBuffer.Commit(size - consumed);
+        }
+    }
+    else
+    {
+        std::memcpy(mInBuffer.GetWritePointer(), data, size);
+        mInBuffer.Commit(size);
+        consumed = DeliverMessages(mInBuffer.GetData(), mInBuffer.GetSize());
+        if (consumed != INVALID_MESSAGE)
+        {
+            mInBuffer.Consume(consumed);
+        }
+    }
+
+    if (consumed == INVALID_MESSAGE)
+    {
+        RLOG(LG_URING, LogLevel::LL_ERROR) << std::quoted(mName, '\'') << " received message with invalid length";
+        mIsClosed = true;
+        OnDisconnect();
+    }
+}
+
+void UringConnection::ReceiveCompletion(int result, unsigned int flags)
+{
+    mReceiveCompletions++;
+
+    // Without IORING_CQE_F_MORE this is the last completion of the current
+    // multishot receive, which will need to be resubmitted.
+    if (!(flags & IORING_CQE_F_MORE))
+    {
+        mIsReceiving = false;
+    }
+
+    if (result > 0 && (flags & IORING_CQE_F_BUFFER))
+    {
+        const unsigned short bid = flags >> IORING_CQE_BUFFER_SHIFT;
+        auto* data = mReceiveBuffers.Get() + bid * mSettings.mReceiveBufferSize;
+        RLOG(LG_URING, LogLevel::LL_DEBUG) << std::quoted(mName, '\'') << " received " << result << " bytes";
+        Receive(data, result);
+        mRing.ProvideBuffer(mBufferRing, mSettings.mReceiveBufferCount, data, mSettings.mReceiveBufferSize, bid);
+    }
+    else if (result == 0)
+    {
+        RLOG(LG_URING, LogLevel::LL_INFO) << std::quoted(mName, '\'') << " remote disconnect";
+        mIsClosed = true;
+        OnDisconnect();
+    }
+    else if (result == -ENOBUFS || result == -EINTR || result == -EAGAIN)
+    {
+        RLOG(LG_URING, LogLevel::LL_DEBUG) << std::quoted(mName, '\'') << " receive interrupted: "
+                                           << errorString(-result);
+    }
+    else if (result < 0)
+    {
+        RLOG(LG_URING, LogLevel::LL_ERROR) << std::quoted(mName, '\'') << " read error: " << errorString(-result);
+        mIsClosed = true;
+        OnDisconnect();
+    }
+
+    if (!mIsReceiving && !mIsClosed)
+    {
+        SubmitReceive();
+    }
+}
+
+void UringConnection::SendFrame(unsigned char const* frame, std::size_t size, SendMode mode)
+{
+    mOutBuffer.Append(frame, size);
+    QueueMessage(mode);
+}
+
+void UringConnection::SendMessage(unsigned char messageType, const ISerialisable& serialisable, SendMode mode)
+{
+    const std::size_t size = MESSAGE_HEADER_SIZE + serialisable.Size();
+    auto* data = mOutBuffer.Prepare(size);
+    *(uint16_t*)data = boost::endian::native_to_big((uint16_t)size);
+    data[MESSAGE_TYPE_OFFSET] = messageType;
+    serialisable.Serialise(data + MESSAGE_HEADER_SIZE);
+    mOutBuffer.Commit(size);
+    QueueMessage(mode);
+}
+
+void UringConnection::SubmitReceive()
+{
+    io_uring_sqe* sqe = mRing.GetSqe();
+    if (!sqe)
+    {
+        throw ReadyTraderGoError("io_uring submission queue is full");
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = mSocket.native_handle();
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RECEIVE_BUFFER_GROUP;
+    sqe->user_data = UringOperation::RECEIVE;
+    mRing.Submit();
+    mIsReceiving = true;
+}
+
+void UringConnection::SubmitWrite()
+{
+    io_uring_sqe* sqe = mRing.GetSqe();
+    if (!sqe)
+    {
+        throw ReadyTraderGoError("io_uring submission queue is full");
+    }
+
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->fd = mSocket.native_handle();
+    sqe->addr = reinterpret_cast<unsigned long long>(mOutBuffer.GetData());
+    sqe->len = mOutBuffer.GetSize();
+    sqe->buf_index = 0;
+    sqe->user_data = UringOperation::WRITE;
+
+    mStatistics.mAsyncWrites++;
+    mOutBuffer.BeginWrite();
+    mRing.Submit();
+}
+
+void UringConnection::WriteCompletion(int result)
+{
+    if (result < 0)
+    {
+        if (result != -EINTR && result != -EAGAIN)
+        {
+            RLOG(LG_URING, LogLevel::LL_ERROR) << std::quoted(mName, '\'') << " send failed: "
+                                               << errorString(-result);
+            throw ReadyTraderGoError("send failed: " + errorString(-result));
+        }
+        result = 0;
+    }
+
+    RLOG(LG_URING, LogLevel::LL_DEBUG) << std::quoted(mName, '\'') << " sent " << result << " bytes";
+    mStatistics.mBytesSent += result;
+    mOutBuffer.EndWrite(result);
+    if (mOutBuffer.GetSize() > 0)
+    {
+        SubmitWrite();
+    }
+}
+
+#endif
+
+UringConnectionFactory::UringConnectionFactory(boost::asio::io_context& context,
+                                               std::string host,
+                                               unsigned short port,
+                                               const UringSettings& settings)
+    : ConnectionFactory(context, std::move(host), port), mSettings(settings)
+{
+    if (!isPowerOfTwo(mSettings.mEntries))
+    {
+        throw ReadyTraderGoError("io_uring entries must be a power of two");
+    }
+
+    if (!isPowerOfTwo(mSettings.mReceiveBufferCount) || mSettings.mReceiveBufferCount > 32768)
+    {
+        throw ReadyTraderGoError("io_uring receive buffer count must be a power of two no greater than 32768");
+    }
+
+    if (mSettings.mReceiveBufferSize == 0 || mSettings.mReceiveBufferSize > MAXIMUM_MESSAGE_SIZE)
+    {
+        throw ReadyTraderGoError("io_uring receive buffer size must be between 1 and "
+                                 + std::to_string(MAXIMUM_MESSAGE_SIZE));
+    }
+}
+
+std::unique_ptr<IConnection> UringConnectionFactory::Create()
+{
+#ifdef RTG_HAVE_IO_URING
+    return std::make_unique<UringConnection>(mContext, Connect(), mSettings);
+#else
+    throw ReadyTraderGoError("the io_uring execution transport is not available on this platform");
+#endif
+}
+
+}
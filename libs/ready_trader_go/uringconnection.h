@@ -0,0 +1,205 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_URINGCONNECTION_H
+#define CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_URINGCONNECTION_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <boost/asio/io_context.hpp>
+
+#include "connectivity.h"
+#include "connectivitytypes.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define RTG_HAVE_IO_URING 1
+#endif
+
+#ifdef RTG_HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/system/error_code.hpp>
+
+#include "buffers.h"
+#include "handlermemory.h"
+
+namespace ReadyTraderGo {
+
+// A minimal io_uring instance driven through the raw system calls.
+class IoUring
+{
+public:
+    IoUring(unsigned int entries, bool sqPoll, unsigned int sqPollIdle);
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    int GetFd() const { return mFd; }
+    unsigned long GetEnterCalls() const { return mEnterCalls; }
+
+    // Return the next free submission queue entry, cleared, or nullptr if
+    // the submission queue is full.
+    io_uring_sqe* GetSqe();
+
+    // Make queued entries visible to the kernel, entering it only when
+    // necessary (i.e. always, unless a kernel thread is polling for them).
+    void Submit();
+
+    // Call handler with each available completion and return the count.
+    template<typename F>
+    unsigned int ReapCompletions(F&& handler);
+
+    void RegisterBuffers(const iovec* buffers, unsigned int count);
+
+    // Register a ring of provided buffers for the given buffer group and
+    // return it. Buffers are added to it with ProvideBuffer.
+    io_uring_buf_ring* RegisterBufferRing(unsigned int entries, unsigned short group);
+    void ProvideBuffer(io_uring_buf_ring* ring, unsigned int entries, void* addr, unsigned int len,
+                       unsigned short bid);
+
+private:
+    int Enter(unsigned int toSubmit, unsigned int flags);
+    void Release();
+
+    int mFd = -1;
+    io_uring_params mParams{};
+
+    void* mSqRing = nullptr;
+    std::size_t mSqRingSize = 0;
+    void* mCqRing = nullptr;
+    std::size_t mCqRingSize = 0;
+    io_uring_sqe* mSqes = nullptr;
+    std::size_t mSqesSize = 0;
+    void* mBufferRing = nullptr;
+    std::size_t mBufferRingSize = 0;
+
+    unsigned int* mSqHead = nullptr;
+    unsigned int* mSqTail = nullptr;
+    unsigned int* mSqFlags = nullptr;
+    unsigned int* mSqArray = nullptr;
+    unsigned int mSqMask = 0;
+    unsigned int mSqLocalTail = 0;
+    unsigned int mSqSubmitted = 0;
+
+    unsigned int* mCqHead = nullptr;
+    unsigned int* mCqTail = nullptr;
+    io_uring_cqe* mCqes = nullptr;
+    unsigned int mCqMask = 0;
+
+    unsigned long mEnterCalls = 0;
+};
+
+// An execution connection whose socket I/O is performed by io_uring.
+//
+// Incoming data arrives through a single multishot receive into a ring of
+// kernel-provided buffers and outgoing messages are written from the send
+// buffer, which is registered with the kernel, so that in the steady state
+// neither direction needs a system call per operation. The completion
+// queue is watched by the io_context, so the connection can be used
+// alongside everything else running on it.
+class UringConnection : public IConnection
+{
+public:
+    UringConnection(boost::asio::io_context& context, tcp::socket&& socket, const UringSettings& settings);
+    ~UringConnection() override;
+
+    void AsyncRead() override;
+    void Flush() override;
+    void SendFrame(unsigned char const* frame, std::size_t size, SendMode mode) override;
+    void SendMessage(unsigned char messageType, const ISerialisable& serialisable, SendMode mode) override;
+    using IConnection::SendMessage;
+
+private:
+    void AsyncWaitForCompletions();
+    void CompletionHandler(const boost::system::error_code& error);
+    void QueueMessage(SendMode mode);
+    void Receive(unsigned char const* data, std::size_t size);
+    void ReceiveCompletion(int result, unsigned int flags);
+    void SubmitReceive();
+    void SubmitWrite();
+    void WriteCompletion(int result);
+
+    boost::asio::io_context& mContext;
+    tcp::socket mSocket;
+    UringSettings mSettings;
+
+    // The buffers must outlive the ring, as the kernel may still be using them.
+    AlignedStorage mReceiveBuffers;
+    ReceiveBuffer mInBuffer;
+    SendBuffer mOutBuffer;
+
+    IoUring mRing;
+    boost::asio::posix::stream_descriptor mRingDescriptor;
+    io_uring_buf_ring* mBufferRing = nullptr;
+
+    HandlerMemory mWaitMemory;
+    HandlerMemory mSendMemory;
+
+    bool mIsSendPosted = false;
+    bool mIsReceiving = false;
+    bool mIsClosed = false;
+    unsigned long mReceiveCompletions = 0;
+};
+
+template<typename F>
+unsigned int IoUring::ReapCompletions(F&& handler)
+{
+    unsigned int head = *mCqHead;
+    const unsigned int tail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+    const unsigned int count = tail - head;
+
+    while (head != tail)
+    {
+        // Copy the entry and release its slot before calling the handler,
+        // which may well submit more work.
+        const io_uring_cqe cqe = mCqes[head & mCqMask];
+        __atomic_store_n(mCqHead, ++head, __ATOMIC_RELEASE);
+        handler(cqe);
+    }
+
+    return count;
+}
+
+}
+
+#endif
+
+namespace ReadyTraderGo {
+
+class UringConnectionFactory : public ConnectionFactory
+{
+public:
+    UringConnectionFactory(boost::asio::io_context& context,
+                           std::string host,
+                           unsigned short port,
+                           const UringSettings& settings);
+
+    std::unique_ptr<IConnection> Create() override;
+
+private:
+    UringSettings mSettings;
+};
+
+}
+
+#endif //CPPREADY_TRADER_GO_LIBS_READY_TRADER_GO_URINGCONNECTION_H
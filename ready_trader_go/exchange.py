@@ -28,7 +28,7 @@ from .limiter import FrequencyLimiterFactory
 from .market_events import MarketEventsReader
 from .match_events import MatchEvents, MatchEventsWriter
 from .order_book import OrderBook
-from .pubsub import PublisherFactory
+from .pubsub import BUFFER_SIZE, PublisherFactory
 from .score_board import ScoreBoardWriter
 from .timer import Timer
 from .types import Instrument
@@ -65,6 +65,8 @@ def __exchange_config_validator(config):
     __validate_object(config, "Execution", ("Host", "Port"), (str, int))
     __validate_object(config, "Fees", ("Maker", "Taker"), (float, float))
     __validate_object(config, "Information", ("Type", "Name"), (str, str))
+    if "BufferSize" in config["Information"] and type(config["Information"]["BufferSize"]) is not int:
+        raise Exception("Element of inappropriate type in Information configuration")
     __validate_object(config, "Instrument", ("EtfClamp", "TickSize",), (float, float))
     __validate_object(config, "Limits", ("ActiveOrderCountLimit", "ActiveVolumeLimit", "MessageFrequencyInterval",
                                          "MessageFrequencyLimit", "PositionLimit"), (int, int, float, int, int))
@@ -111,7 +113,8 @@ def setup(app: Application) -> Controller:
     limiter_factory = FrequencyLimiterFactory(limits["MessageFrequencyInterval"] / engine["Speed"],
                                               limits["MessageFrequencyLimit"])
     exec_server = ExecutionServer(exec_["Host"], exec_["Port"], competitor_manager, limiter_factory)
-    info_publisher = InformationPublisher(app.event_loop, PublisherFactory(info["Type"], info["Name"]),
+    info_publisher = InformationPublisher(app.event_loop, PublisherFactory(info["Type"], info["Name"],
+                                                                           info.get("BufferSize", BUFFER_SIZE)),
                                           (future_book, etf_book), tick_timer)
 
     market_timer = Timer(engine["MarketEventInterval"], engine["Speed"])
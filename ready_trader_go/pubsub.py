@@ -16,14 +16,18 @@
 #     License along with Ready Trader Go.  If not, see
 #     <https://www.gnu.org/licenses/>.
 import asyncio
+import ipaddress
 import mmap
 import os
+import socket
 import struct
 
+from multiprocessing import resource_tracker, shared_memory
 from typing import Coroutine, Optional, Tuple, Union
 
 BUFFER_SIZE = 8192
 FRAME_HEADER_SIZE = 8
+FRAME_NUMBER_MASK = 0xFFFFFF
 FRAME_SIZE = 128
 MAXIMUM_PAYLOAD_LENGTH = FRAME_SIZE - FRAME_HEADER_SIZE
 
@@ -35,16 +39,18 @@ class Publisher(asyncio.WriteTransport):
     memory blocks. There must be an interval between writes to permit
     subscribers to read the data before it is overwritten.
     """
-    __slots__ = ("__pack_into", "_buffer", "_closed", "_pos")
+    __slots__ = ("__pack_into", "_buffer", "_closed", "_frame", "_mask", "_pos")
 
     def __init__(self, buffer: Union[mmap.mmap, memoryview], protocol: asyncio.BaseProtocol):
         super().__init__()
         self._buffer: Optional[Union[mmap.mmap, memoryview]] = buffer
         self._closed: bool = False
+        self._frame: int = 0
+        self._mask: int = len(buffer) - 1
         self._pos: int = 0
         asyncio.get_event_loop().call_soon(protocol.connection_made, self)
 
-        self.__pack_into = struct.Struct("!I").pack_into
+        self.__pack_into = struct.Struct("!II").pack_into
 
     def __del__(self):
         if not self._closed:
@@ -70,13 +76,15 @@ class Publisher(asyncio.WriteTransport):
         if self._closed:
             return
 
-        # Each frame contains a spinlock (4 bytes), payload length (4 bytes)
-        # and payload (up to 120 bytes).
+        # Each frame contains a spinlock (1 byte), frame number (3 bytes),
+        # payload length (4 bytes) and payload (up to 120 bytes). The frame
+        # number lets subscribers tell when they have been lapped.
         pos = self._pos
-        self.__pack_into(self._buffer, pos + 4, len(data))
+        self.__pack_into(self._buffer, pos, self._frame, len(data))
         start: int = pos + FRAME_HEADER_SIZE
         self._buffer[start:start + len(data)] = bytes(data)
-        self._pos = (pos + FRAME_SIZE) & (BUFFER_SIZE - 1)
+        self._frame = (self._frame + 1) & FRAME_NUMBER_MASK
+        self._pos = (pos + FRAME_SIZE) & self._mask
         self._buffer[self._pos] = 0
         self._buffer[pos] = 1
 
@@ -100,6 +108,89 @@ class MmapPublisher(Publisher):
             self.__fileno = None
 
 
+class ShmPublisher(Publisher):
+    """A publisher based on a POSIX shared memory block (i.e. shm_open)."""
+    __slots__ = ("__shm",)
+
+    def __init__(self, shm: shared_memory.SharedMemory, protocol: asyncio.BaseProtocol):
+        super().__init__(shm.buf, protocol)
+        self.__shm: Optional[shared_memory.SharedMemory] = shm
+
+    def close(self) -> None:
+        """Close the publisher and remove the shared memory block."""
+        super().close()
+        if self.__shm:
+            # The buffer is a view of the block, which can't be closed while
+            # the view exists.
+            self._buffer = None
+            self.__shm.close()
+            self.__shm.unlink()
+            self.__shm = None
+
+
+def _parse_udp_address(name: str) -> Tuple[str, int]:
+    """Split a name of the form 'address:port' into its two parts."""
+    host, sep, port = name.rpartition(":")
+    if not sep or not host or not port.isdigit() or not 0 < int(port) < 65536:
+        raise ValueError("name must be of the form 'address:port' for the udp type")
+    return host.strip("[]"), int(port)
+
+
+class UdpPublisher(asyncio.WriteTransport):
+    """Publisher side of a datagram transport based on UDP.
+
+    Each write is sent as a single datagram to either a unicast address or
+    a multicast group. Like any UDP transport, datagrams that cannot be
+    sent immediately are dropped rather than queued.
+    """
+    __slots__ = ("_address", "_closed", "_socket")
+
+    def __init__(self, address: Tuple[str, int], protocol: asyncio.BaseProtocol, ttl: int = 1):
+        super().__init__()
+        ip = ipaddress.ip_address(address[0])
+        family = socket.AF_INET6 if ip.version == 6 else socket.AF_INET
+        self._address: Tuple[str, int] = address
+        self._closed: bool = False
+        self._socket: Optional[socket.socket] = socket.socket(family, socket.SOCK_DGRAM)
+        self._socket.setblocking(False)
+        if ip.is_multicast:
+            if family == socket.AF_INET:
+                self._socket.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, ttl)
+                self._socket.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+            else:
+                self._socket.setsockopt(socket.IPPROTO_IPV6, socket.IPV6_MULTICAST_HOPS, ttl)
+                self._socket.setsockopt(socket.IPPROTO_IPV6, socket.IPV6_MULTICAST_LOOP, 1)
+        asyncio.get_event_loop().call_soon(protocol.connection_made, self)
+
+    def __del__(self):
+        if not self._closed:
+            self.close()
+
+    def abort(self) -> None:
+        """Close the publisher immediately."""
+        self.close()
+
+    def can_write_eof(self) -> bool:
+        """Return False. Publisher's don't support writing EOF."""
+        return False
+
+    def close(self) -> None:
+        """Close the publisher."""
+        self._closed = True
+        if self._socket:
+            self._socket.close()
+            self._socket = None
+
+    def write(self, data: Union[bytearray, bytes, memoryview]) -> None:
+        """Publish the provided data."""
+        if self._closed:
+            return
+        try:
+            self._socket.sendto(data, self._address)
+        except (BlockingIOError, InterruptedError, ConnectionRefusedError):
+            pass
+
+
 class Subscriber(asyncio.DatagramTransport):
     """Subscriber side of a datagram transport based on shared memory.
 
@@ -122,7 +213,7 @@ class Subscriber(asyncio.DatagramTransport):
     async def _subscribe_worker(self, buffer: Union[mmap.mmap, memoryview],
                                 from_addr: Tuple[str, int],
                                 protocol: asyncio.DatagramProtocol) -> None:
-        mask: int = BUFFER_SIZE - 1
+        mask: int = len(buffer) - 1
         unpack_from = struct.Struct("!I").unpack_from
         protocol.connection_made(self)
 
@@ -187,13 +278,102 @@ class MmapSubscriber(Subscriber):
             self.__fileno = None
 
 
+class ShmSubscriber(Subscriber):
+    """A subscriber based on a POSIX shared memory block (i.e. shm_open)."""
+    __slots__ = ("__shm",)
+
+    def __init__(self, shm: shared_memory.SharedMemory, from_addr: Tuple[str, int],
+                 protocol: Optional[asyncio.DatagramProtocol] = None):
+        super().__init__(shm.buf, from_addr, protocol)
+        self.__shm: Optional[shared_memory.SharedMemory] = shm
+        self._task.add_done_callback(lambda _: self.__close_shm())
+
+    def __close_shm(self):
+        if self.__shm:
+            try:
+                self.__shm.close()
+            except BufferError:
+                pass
+            self.__shm = None
+
+
+class UdpSubscriber(asyncio.DatagramTransport):
+    """Subscriber side of a datagram transport based on UDP."""
+    __slots__ = ("_closed", "_protocol", "_socket")
+
+    def __init__(self, address: Tuple[str, int], protocol: asyncio.DatagramProtocol):
+        super().__init__()
+        ip = ipaddress.ip_address(address[0])
+        family = socket.AF_INET6 if ip.version == 6 else socket.AF_INET
+        self._closed: bool = False
+        self._protocol: asyncio.DatagramProtocol = protocol
+        self._socket: socket.socket = socket.socket(family, socket.SOCK_DGRAM)
+        self._socket.setblocking(False)
+        if ip.is_multicast:
+            self._socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+            self._socket.bind(("", address[1]))
+            if family == socket.AF_INET:
+                mreq = struct.pack("4s4s", ip.packed, socket.inet_aton("0.0.0.0"))
+                self._socket.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+            else:
+                mreq = struct.pack("16sI", ip.packed, 0)
+                self._socket.setsockopt(socket.IPPROTO_IPV6, socket.IPV6_JOIN_GROUP, mreq)
+        else:
+            self._socket.bind(address)
+
+        loop = asyncio.get_event_loop()
+        loop.add_reader(self._socket.fileno(), self._read_ready)
+        loop.call_soon(protocol.connection_made, self)
+
+    def _read_ready(self) -> None:
+        while True:
+            try:
+                data, from_addr = self._socket.recvfrom(FRAME_SIZE)
+            except (BlockingIOError, InterruptedError):
+                return
+            except OSError as e:
+                self._protocol.error_received(e)
+                return
+            self._protocol.datagram_received(data, from_addr)
+
+    def abort(self) -> None:
+        """Close the transport immediately."""
+        self.close()
+
+    def is_closing(self):
+        """Return True if the subscriber is closing or is closed."""
+        return self._closed
+
+    def close(self) -> None:
+        """Close the subscriber."""
+        if not self._closed:
+            self._closed = True
+            asyncio.get_event_loop().remove_reader(self._socket.fileno())
+            self._socket.close()
+            self._protocol.connection_lost(None)
+
+    def get_protocol(self) -> asyncio.DatagramProtocol:
+        """Return the current protocol."""
+        return self._protocol
+
+    def sendto(self, data: Union[bytearray, bytes, memoryview],
+               addr: Optional[Tuple[str, int]] = None) -> None:
+        """Send data to the transport."""
+        raise RuntimeError("Attempt to write to a Subscriber (a read-only transport)")
+
+
 class PublisherFactory:
     """A factory class for Publisher instances."""
-    def __init__(self, typ: str, name: str):
-        if typ not in ("mmap", "shm"):
-            raise ValueError("type must be either 'mmap' or 'shm'")
+    def __init__(self, typ: str, name: str, buffer_size: int = BUFFER_SIZE):
+        if typ not in ("mmap", "shm", "udp"):
+            raise ValueError("type must be one of 'mmap', 'shm' or 'udp'")
+        if typ == "udp":
+            _parse_udp_address(name)
+        if buffer_size < 2 * FRAME_SIZE or buffer_size & (buffer_size - 1) != 0:
+            raise ValueError("buffer size must be a power of two holding at least two frames")
         self.__typ: str = typ
         self.__name: str = name
+        self.__buffer_size: int = buffer_size
 
     @property
     def name(self):
@@ -208,18 +388,34 @@ class PublisherFactory:
     def create(self, protocol: asyncio.BaseProtocol) -> Publisher:
         """Create a new Publisher instance."""
         if self.__typ == "mmap":
-            fileno = os.open(self.__name, os.O_CREAT | os.O_RDWR)
-            os.write(fileno, b"\x00" * BUFFER_SIZE)
-            buffer = mmap.mmap(fileno, BUFFER_SIZE, access=mmap.ACCESS_WRITE)
+            # Truncate so that subscribers can take the ring size from the file size.
+            fileno = os.open(self.__name, os.O_CREAT | os.O_RDWR | os.O_TRUNC)
+            os.ftruncate(fileno, self.__buffer_size)
+            buffer = mmap.mmap(fileno, self.__buffer_size, access=mmap.ACCESS_WRITE)
             return MmapPublisher(fileno, buffer, protocol)
-        raise RuntimeError("PublisherFactory type was not 'mmap'")
+        if self.__typ == "shm":
+            # Replace any block left behind by a previous run, so that
+            # subscribers can take the ring size from the block's size.
+            try:
+                stale = shared_memory.SharedMemory(self.__name)
+                stale.close()
+                stale.unlink()
+            except FileNotFoundError:
+                pass
+            shm = shared_memory.SharedMemory(self.__name, create=True, size=self.__buffer_size)
+            return ShmPublisher(shm, protocol)
+        if self.__typ == "udp":
+            return UdpPublisher(_parse_udp_address(self.__name), protocol)
+        raise RuntimeError("PublisherFactory type was not 'mmap', 'shm' or 'udp'")
 
 
 class SubscriberFactory:
     """A factory class for Subscribers."""
     def __init__(self, typ: str, name: str):
-        if typ not in ("mmap", "shm"):
-            raise ValueError("type must be either 'mmap' or 'shm'")
+        if typ not in ("mmap", "shm", "udp"):
+            raise ValueError("type must be one of 'mmap', 'shm' or 'udp'")
+        if typ == "udp":
+            _parse_udp_address(name)
         self.__typ: str = typ
         self.__name: str = name
 
@@ -237,6 +433,13 @@ class SubscriberFactory:
         """Return a new Subscriber instance."""
         if self.__typ == "mmap":
             fileno = os.open(self.__name, os.O_RDONLY)
-            mm = mmap.mmap(fileno, BUFFER_SIZE, access=mmap.ACCESS_READ)
+            mm = mmap.mmap(fileno, 0, access=mmap.ACCESS_READ)
             return MmapSubscriber(fileno, mm, (self.__name, fileno), protocol)
-        raise RuntimeError("SubscriberFactory type was not 'mmap'")
+        if self.__typ == "shm":
+            shm = shared_memory.SharedMemory(self.__name)
+            # Only the publisher should remove the block when it exits.
+            resource_tracker.unregister(shm._name, "shared_memory")
+            return ShmSubscriber(shm, (self.__name, 0), protocol)
+        if self.__typ == "udp":
+            return UdpSubscriber(_parse_udp_address(self.__name), protocol)
+        raise RuntimeError("SubscriberFactory type was not 'mmap', 'shm' or 'udp'")
@@ -0,0 +1,180 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <ready_trader_go/application.h>
+#include <ready_trader_go/connectivity.h>
+#include <ready_trader_go/error.h>
+#include <ready_trader_go/handlermemory.h>
+#include <ready_trader_go/logging.h>
+#include <ready_trader_go/shmconnection.h>
+
+RTG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_BRIDGE, "BRIDGE")
+
+using namespace ReadyTraderGo;
+
+// Relays an auto-trader's shared-memory execution channel to and from the
+// exchange's TCP execution port, so that the shared-memory transport can be
+// used against an unmodified exchange on the same machine.
+//
+// The channel is created when the configuration is loaded, so the bridge
+// must be started before the auto-trader. The exchange connection is only
+// made once the auto-trader sends its first message (i.e. its login).
+class ShmBridge
+{
+public:
+    explicit ShmBridge(Application& app) : mContext(app.GetContext())
+    {
+        app.ConfigLoaded = [this](const auto& tree) { ConfigLoadedHandler(tree); };
+        app.ReadyToRun = [this] { PostPoll(); };
+    }
+
+    ~ShmBridge()
+    {
+        if (mFromExchange)
+        {
+            mFromExchange->Close();
+        }
+    }
+
+private:
+    void ConfigLoadedHandler(const boost::property_tree::ptree& tree)
+    {
+        const auto name = tree.get<std::string>("Execution.Name", "exec.dat");
+        const auto ringSize = tree.get<std::size_t>("Execution.RingSize", DEFAULT_SHM_RING_SIZE);
+        mChannel = std::make_unique<ShmChannel>(name, ringSize);
+        mToExchange = std::make_unique<ShmRing>(mChannel->GetRing(TO_EXCHANGE));
+        mFromExchange = std::make_unique<ShmRing>(mChannel->GetRing(FROM_EXCHANGE));
+        mConnectionFactory = std::make_unique<ConnectionFactory>(mContext,
+                                                                 tree.get<std::string>("Execution.Host"),
+                                                                 tree.get<unsigned short>("Execution.Port"));
+        RLOG(LG_BRIDGE, LogLevel::LL_INFO) << "created execution channel '" << name << "': ring size=" << ringSize;
+    }
+
+    void Connect()
+    {
+        mConnection = mConnectionFactory->Create();
+        mConnection->SetName("Exchange");
+        mConnection->Disconnected = [this] { Stop("exchange disconnected"); };
+        mConnection->MessageReceived = [this](IConnection*, unsigned char type, unsigned char const* data,
+                                              std::size_t size) { Relay(type, data, size); };
+        mConnection->AsyncRead();
+    }
+
+    void Poll()
+    {
+        const bool isTraderClosed = mToExchange->IsClosed();
+
+        // Everything taken from the ring in one poll goes to the exchange in
+        // a single write.
+        std::size_t count;
+        if (mConnection)
+        {
+            mConnection->BeginBatch();
+        }
+        try
+        {
+            count = mToExchange->Consume([this](unsigned char const* data, std::size_t size) {
+                if (!mConnection)
+                {
+                    Connect();
+                    mConnection->BeginBatch();
+                }
+                mConnection->SendFrame(data, size, SendMode::ASAP);
+            });
+        }
+        catch (const ReadyTraderGoError& e)
+        {
+            Stop(e.what());
+            return;
+        }
+        if (mConnection)
+        {
+            mConnection->EndBatch();
+        }
+
+        if (isTraderClosed && count == 0)
+        {
+            Stop("auto-trader disconnected");
+            return;
+        }
+
+        PostPoll();
+    }
+
+    void PostPoll()
+    {
+        boost::asio::post(mContext, makeAllocatingHandler(mPollMemory, [this] { Poll(); }));
+    }
+
+    void Relay(unsigned char type, unsigned char const* data, std::size_t size)
+    {
+        const std::size_t length = MESSAGE_HEADER_SIZE + size;
+        unsigned char* frame = mFromExchange->Prepare(length);
+        if (frame == nullptr)
+        {
+            Stop("execution channel is full");
+            return;
+        }
+        *(uint16_t*)frame = boost::endian::native_to_big((uint16_t)length);
+        frame[MESSAGE_TYPE_OFFSET] = type;
+        std::memcpy(frame + MESSAGE_HEADER_SIZE, data, size);
+        mFromExchange->Commit(length);
+        mFromExchange->Publish();
+    }
+
+    void Stop(const std::string& reason)
+    {
+        RLOG(LG_BRIDGE, LogLevel::LL_INFO) << reason << ", shutting down";
+        mFromExchange->Close();
+        mContext.stop();
+    }
+
+    boost::asio::io_context& mContext;
+    std::unique_ptr<ShmChannel> mChannel;
+    std::unique_ptr<ShmRing> mToExchange;
+    std::unique_ptr<ShmRing> mFromExchange;
+    std::unique_ptr<ConnectionFactory> mConnectionFactory;
+    std::unique_ptr<IConnection> mConnection;
+    HandlerMemory mPollMemory;
+};
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        Application app;
+        ShmBridge bridge{app};
+        app.Run(argc, argv);
+    }
+    catch (const ReadyTraderGoError& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,47 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#ifndef CPPREADY_TRADER_GO_UNIT_TESTS_DESCRIBE_H
+#define CPPREADY_TRADER_GO_UNIT_TESTS_DESCRIBE_H
+
+#include <string>
+
+#include <ready_trader_go/ordercommands.h>
+
+// A short description of an order operation, for comparing the operations
+// sent in a test with those expected, e.g. "insert 3 BUY 10@100".
+inline std::string describe(const ReadyTraderGo::OrderCommand& command)
+{
+    using ReadyTraderGo::OrderCommandType;
+    const std::string id = std::to_string(command.mClientOrderId);
+    const std::string order = std::string(command.mSide == ReadyTraderGo::Side::BUY ? " BUY " : " SELL ")
+                              + std::to_string(command.mVolume) + "@" + std::to_string(command.mPrice);
+    switch (command.mType)
+    {
+    case OrderCommandType::INSERT:
+        return "insert " + id + order;
+    case OrderCommandType::AMEND:
+        return "amend " + id + " to " + std::to_string(command.mVolume);
+    case OrderCommandType::CANCEL:
+        return "cancel " + id;
+    case OrderCommandType::HEDGE:
+        return "hedge " + id + order;
+    }
+    return "unknown";
+}
+
+#endif //CPPREADY_TRADER_GO_UNIT_TESTS_DESCRIBE_H
@@ -0,0 +1,201 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <ready_trader_go/frequencylimiter.h>
+#include <ready_trader_go/orderscheduler.h>
+
+#include "describe.h"
+
+using namespace ReadyTraderGo;
+
+namespace {
+
+using Expected = std::vector<std::string>;
+
+// Orders are released against a message budget kept on a clock that only
+// moves when told to. Each order released is described by its key.
+struct OrderSchedulerFixture
+{
+    static constexpr std::size_t MESSAGE_LIMIT = 2;
+
+    boost::asio::io_context context;
+    OrderScheduler scheduler{context, 4};
+    FrequencyLimiter frequency{std::chrono::seconds(1), MESSAGE_LIMIT};
+    FrequencyLimiter::Clock::time_point now{};
+
+    template<typename F>
+    Expected Release(F&& handler)
+    {
+        Expected released;
+        scheduler.Release([this] { return frequency.IsAvailable(now); }, [&](const ScheduledOrder& order) {
+            frequency.Record(now);
+            OrderCommand command = order.mCommand;
+            command.mClientOrderId = order.mKey;
+            released.push_back(describe(command));
+            handler(order);
+        });
+        return released;
+    }
+
+    // Release everything waiting, with as much budget as it takes.
+    Expected ReleaseAll()
+    {
+        Expected released;
+        while (!scheduler.IsEmpty())
+        {
+            now += std::chrono::seconds(1);
+            for (auto& order : Release([](const ScheduledOrder&) {}))
+            {
+                released.push_back(order);
+            }
+        }
+        return released;
+    }
+};
+
+}
+
+BOOST_FIXTURE_TEST_SUITE(OrderSchedulerTests, OrderSchedulerFixture)
+
+BOOST_AUTO_TEST_CASE(SendsCancelsAmendsAndHedgesBeforeInserts)
+{
+    BOOST_TEST(scheduler.ScheduleInsert(7, Side::BUY, 100, 10, Lifespan::GOOD_FOR_DAY));
+    BOOST_TEST(scheduler.ScheduleCancel(3));
+    BOOST_TEST(scheduler.ScheduleHedge(8, Side::SELL, 99, 5));
+    BOOST_TEST(scheduler.ScheduleAmend(4, 6));
+    BOOST_TEST(ReleaseAll() == (Expected{"cancel 3", "hedge 8 SELL 5@99", "amend 4 to 6", "insert 7 BUY 10@100"}),
+               boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(CoalescesInsertsWithTheSameKey)
+{
+    BOOST_TEST(scheduler.ScheduleInsert(1, Side::BUY, 100, 10, Lifespan::GOOD_FOR_DAY));
+    BOOST_TEST(scheduler.ScheduleInsert(2, Side::SELL, 102, 10, Lifespan::GOOD_FOR_DAY));
+    BOOST_TEST(scheduler.ScheduleInsert(1, Side::BUY, 101, 5, Lifespan::GOOD_FOR_DAY));
+    BOOST_TEST(ReleaseAll() == (Expected{"insert 1 BUY 5@101", "insert 2 SELL 10@102"}),
+               boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(CoalescesAmendsAndCancels)
+{
+    BOOST_TEST(scheduler.ScheduleAmend(1, 8));
+    BOOST_TEST(scheduler.ScheduleAmend(1, 6));
+    BOOST_TEST(scheduler.ScheduleAmend(2, 5));
+    BOOST_TEST(scheduler.ScheduleCancel(2));
+    BOOST_TEST(scheduler.ScheduleCancel(3));
+    BOOST_TEST(scheduler.ScheduleAmend(3, 4));
+    BOOST_TEST(scheduler.ScheduleCancel(3));
+    BOOST_TEST(ReleaseAll() == (Expected{"amend 1 to 6", "cancel 2", "cancel 3"}), boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(UnschedulesAWaitingInsert)
+{
+    BOOST_TEST(scheduler.ScheduleInsert(1, Side::BUY, 100, 10, Lifespan::GOOD_FOR_DAY));
+    BOOST_TEST(scheduler.Unschedule(1));
+    BOOST_TEST(!scheduler.Unschedule(1));
+    BOOST_TEST(scheduler.IsEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(ReleasesOnlyWhatTheBudgetAllows)
+{
+    for (unsigned long key = 1; key != 4; ++key)
+    {
+        BOOST_TEST(scheduler.ScheduleInsert(key, Side::BUY, 100, key, Lifespan::GOOD_FOR_DAY));
+    }
+    BOOST_TEST(Release([](const ScheduledOrder&) {}) == (Expected{"insert 1 BUY 1@100", "insert 2 BUY 2@100"}),
+               boost::test_tools::per_element());
+    BOOST_TEST(Release([](const ScheduledOrder&) {}).empty());
+
+    now += std::chrono::seconds(1);
+    BOOST_TEST(Release([](const ScheduledOrder&) {}) == Expected{"insert 3 BUY 3@100"},
+               boost::test_tools::per_element());
+    BOOST_TEST(scheduler.IsEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(RequeuedOrdersWaitForTheNextRelease)
+{
+    BOOST_TEST(scheduler.ScheduleCancel(1));
+    BOOST_TEST(scheduler.ScheduleInsert(2, Side::BUY, 100, 10, Lifespan::GOOD_FOR_DAY));
+
+    // Each order is passed on once, however much budget there is.
+    frequency = FrequencyLimiter{std::chrono::seconds(1), 10};
+    BOOST_TEST(Release([this](const ScheduledOrder& order) { BOOST_TEST(scheduler.Requeue(order)); })
+               == (Expected{"cancel 1", "insert 2 BUY 10@100"}),
+               boost::test_tools::per_element());
+    BOOST_TEST(ReleaseAll() == (Expected{"cancel 1", "insert 2 BUY 10@100"}), boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(DropsRequeuedOrdersThatHaveBeenSuperseded)
+{
+    BOOST_TEST(scheduler.ScheduleInsert(1, Side::BUY, 100, 10, Lifespan::GOOD_FOR_DAY));
+    BOOST_TEST(scheduler.ScheduleAmend(2, 5));
+    BOOST_TEST(scheduler.ScheduleCancel(3));
+
+    std::vector<ScheduledOrder> refused;
+    frequency = FrequencyLimiter{std::chrono::seconds(1), 10};
+    Release([&refused](const ScheduledOrder& order) { refused.push_back(order); });
+
+    // Newer orders arrive before the refused ones are put back.
+    BOOST_TEST(scheduler.ScheduleInsert(1, Side::BUY, 101, 5, Lifespan::GOOD_FOR_DAY));
+    BOOST_TEST(scheduler.ScheduleCancel(2));
+    BOOST_TEST(scheduler.ScheduleAmend(3, 4));
+    for (const auto& order : refused)
+    {
+        BOOST_TEST(scheduler.Requeue(order));
+    }
+
+    // The refused insert and amend are superseded, and the refused cancel
+    // turns the newer amend into a cancel.
+    BOOST_TEST(ReleaseAll() == (Expected{"cancel 2", "cancel 3", "insert 1 BUY 5@101"}),
+               boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(RefusesOrdersWhenFull)
+{
+    for (unsigned long key = 1; key != 5; ++key)
+    {
+        BOOST_TEST(scheduler.ScheduleHedge(key, Side::BUY, 100, 1));
+        BOOST_TEST(scheduler.ScheduleInsert(key, Side::BUY, 100, 1, Lifespan::GOOD_FOR_DAY));
+    }
+    BOOST_TEST(!scheduler.ScheduleHedge(5, Side::BUY, 100, 1));
+    BOOST_TEST(!scheduler.ScheduleCancel(5));
+    BOOST_TEST(!scheduler.ScheduleInsert(5, Side::BUY, 100, 1, Lifespan::GOOD_FOR_DAY));
+
+    // An insert that replaces one already waiting needs no room.
+    BOOST_TEST(scheduler.ScheduleInsert(4, Side::BUY, 100, 2, Lifespan::GOOD_FOR_DAY));
+}
+
+BOOST_AUTO_TEST_CASE(WakesTheOwnerWhenBudgetIsAvailable)
+{
+    int wakeups = 0;
+    scheduler.BudgetAvailable = [&wakeups] { ++wakeups; };
+
+    // An earlier wakeup replaces a later one.
+    scheduler.WakeAt(OrderScheduler::Clock::now() + std::chrono::hours(1));
+    scheduler.WakeAt(OrderScheduler::Clock::now());
+    context.run();
+    BOOST_TEST(wakeups == 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
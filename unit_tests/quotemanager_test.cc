@@ -0,0 +1,261 @@
+// Copyright 2021 Optiver Asia Pacific Pty. Ltd.
+//
+// This file is part of Ready Trader Go.
+//
+//     Ready Trader Go is free software: you can redistribute it and/or
+//     modify it under the terms of the GNU Affero General Public License
+//     as published by the Free Software Foundation, either version 3 of
+//     the License, or (at your option) any later version.
+//
+//     Ready Trader Go is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU Affero General Public License for more details.
+//
+//     You should have received a copy of the GNU Affero General Public
+//     License along with Ready Trader Go.  If not, see
+//     <https://www.gnu.org/licenses/>.
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <ready_trader_go/frequencylimiter.h>
+#include <ready_trader_go/ordercommands.h>
+#include <ready_trader_go/ordermanager.h>
+#include <ready_trader_go/quotemanager.h>
+
+#include "describe.h"
+
+using namespace ReadyTraderGo;
+
+namespace {
+
+// Just enough of a BaseAutoTraderT for a QuoteManager. Orders sent are
+// recorded in place of being written to a connection, the message budget
+// is kept against a clock that only moves when told to, and the tests play
+// the exchange by applying its reports to the order manager.
+class FakeTrader
+{
+public:
+    using Clock = FrequencyLimiter::Clock;
+
+    static constexpr std::size_t MESSAGE_LIMIT = 4;
+
+    FakeTrader() : mFrequency(std::chrono::seconds(1), MESSAGE_LIMIT) {}
+
+    bool SendAmendOrder(unsigned long clientOrderId, unsigned long volume)
+    {
+        return Send({OrderCommandType::AMEND, Side::SELL, Lifespan::FILL_AND_KILL, clientOrderId, 0, volume});
+    }
+
+    bool SendCancelOrder(unsigned long clientOrderId)
+    {
+        return Send({OrderCommandType::CANCEL, Side::SELL, Lifespan::FILL_AND_KILL, clientOrderId, 0, 0});
+    }
+
+    bool SendInsertOrder(unsigned long clientOrderId,
+                         Side side,
+                         unsigned long price,
+                         unsigned long volume,
+                         Lifespan lifespan)
+    {
+        if (!Send({OrderCommandType::INSERT, side, lifespan, clientOrderId, price, volume}))
+        {
+            return false;
+        }
+        mLastClientOrderId = clientOrderId;
+        mOrders.Insert(clientOrderId, side, price, volume, lifespan);
+        return true;
+    }
+
+    std::size_t ReleaseScheduledOrders()
+    {
+        ++mReleases;
+        return 0;
+    }
+
+    bool HasScheduledOrders() const { return mHasScheduledOrders; }
+    unsigned long NextClientOrderId() const { return mLastClientOrderId + 1; }
+    const OrderManager& GetOrders() const { return mOrders; }
+
+    // The exchange's side.
+    void Acknowledge(unsigned long clientOrderId)
+    {
+        const Order* order = mOrders.Find(clientOrderId);
+        mOrders.ApplyOrderStatus(clientOrderId, order->mFillVolume, order->mRemainingVolume, 0);
+    }
+
+    void Fill(unsigned long clientOrderId, unsigned long volume)
+    {
+        const Order* order = mOrders.Find(clientOrderId);
+        mOrders.ApplyOrderFilled(clientOrderId, order->mPrice, volume);
+        mOrders.ApplyOrderStatus(clientOrderId, order->mFillVolume, order->mRemainingVolume, 0);
+    }
+
+    void Cancelled(unsigned long clientOrderId)
+    {
+        mOrders.ApplyOrderStatus(clientOrderId, mOrders.Find(clientOrderId)->mFillVolume, 0, 0);
+    }
+
+    void Rejected(unsigned long clientOrderId) { mOrders.ApplyError(clientOrderId); }
+
+    // Return the orders sent since the last call.
+    std::vector<std::string> TakeSent()
+    {
+        std::vector<std::string> sent;
+        sent.swap(mSent);
+        return sent;
+    }
+
+    Clock::time_point mNow{};
+    bool mHasScheduledOrders = false;
+    std::size_t mReleases = 0;
+
+private:
+    bool Send(const OrderCommand& command)
+    {
+        if (!mFrequency.TryRecord(mNow))
+        {
+            return false;
+        }
+        mSent.push_back(describe(command));
+        return true;
+    }
+
+    FrequencyLimiter mFrequency;
+    OrderManager mOrders;
+    unsigned long mLastClientOrderId = 0;
+    std::vector<std::string> mSent;
+};
+
+using Expected = std::vector<std::string>;
+
+struct QuoteManagerFixture
+{
+    FakeTrader trader;
+    QuoteManager<FakeTrader> quotes{trader};
+
+    // Quote a ladder on the bid side, let the exchange acknowledge every
+    // insert and move the clock on so the next call has a full budget.
+    Expected Quote(const std::vector<QuoteLevel>& levels)
+    {
+        quotes.SetQuotes(Side::BUY, levels.data(), levels.size());
+        Expected sent = trader.TakeSent();
+        for (const auto& message : sent)
+        {
+            if (message.rfind("insert ", 0) == 0)
+            {
+                trader.Acknowledge(std::stoul(message.substr(7)));
+            }
+        }
+        trader.mNow += std::chrono::seconds(1);
+        return sent;
+    }
+};
+
+}
+
+BOOST_FIXTURE_TEST_SUITE(QuoteManagerTests, QuoteManagerFixture)
+
+BOOST_AUTO_TEST_CASE(InsertsTheShortfall)
+{
+    BOOST_TEST(Quote({{100, 10}, {99, 5}}) == (Expected{"insert 1 BUY 10@100", "insert 2 BUY 5@99"}),
+               boost::test_tools::per_element());
+
+    // Nothing is sent while the quotes are right.
+    BOOST_TEST(Quote({{100, 10}, {99, 5}}).empty());
+
+    BOOST_TEST(Quote({{100, 15}, {99, 5}}) == Expected{"insert 3 BUY 5@100"}, boost::test_tools::per_element());
+    BOOST_TEST(quotes.GetQuotedVolume(Side::BUY, 100) == 15ul);
+}
+
+BOOST_AUTO_TEST_CASE(TopsUpAfterAFill)
+{
+    Quote({{100, 10}});
+    trader.Fill(1, 4);
+    BOOST_TEST(Quote({{100, 10}}) == Expected{"insert 2 BUY 4@100"}, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(AmendsDownNewestFirst)
+{
+    Quote({{100, 5}});
+    Quote({{100, 8}});
+
+    // The newest order goes entirely, and the oldest keeps its place.
+    BOOST_TEST(Quote({{100, 4}}) == (Expected{"cancel 2", "amend 1 to 4"}), boost::test_tools::per_element());
+    BOOST_TEST(quotes.GetQuotedVolume(Side::BUY, 100) == 4ul);
+}
+
+BOOST_AUTO_TEST_CASE(AmendsIncludeFilledVolume)
+{
+    Quote({{100, 10}});
+    trader.Fill(1, 3);
+
+    // Seven remain; keeping five means a total volume of eight.
+    BOOST_TEST(Quote({{100, 5}}) == Expected{"amend 1 to 8"}, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(CancelsUnwantedPricesBeforeInserting)
+{
+    Quote({{100, 10}, {99, 5}});
+    BOOST_TEST(Quote({{99, 5}, {98, 5}}) == (Expected{"cancel 1", "insert 3 BUY 5@98"}),
+               boost::test_tools::per_element());
+
+    // A cancel that hasn't been acknowledged yet isn't sent again.
+    BOOST_TEST(Quote({{99, 5}, {98, 5}}).empty());
+    BOOST_TEST(quotes.GetQuotedVolume(Side::BUY, 100) == 0ul);
+
+    BOOST_TEST(Quote({}) == (Expected{"cancel 2", "cancel 3"}), boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(PrunesOrdersThatAreNoLongerLive)
+{
+    Quote({{100, 10}, {99, 5}});
+    trader.Fill(1, 10);
+    trader.Cancelled(2);
+
+    // Neither is cancelled, as neither is live; both are replaced.
+    BOOST_TEST(Quote({{100, 10}, {99, 5}}) == (Expected{"insert 3 BUY 10@100", "insert 4 BUY 5@99"}),
+               boost::test_tools::per_element());
+
+    // Likewise for an insert the exchange rejects.
+    quotes.SetQuotes(Side::BUY, std::array<QuoteLevel, 3>{{{100, 10}, {99, 5}, {98, 5}}});
+    BOOST_TEST(trader.TakeSent() == Expected{"insert 5 BUY 5@98"}, boost::test_tools::per_element());
+    trader.Rejected(5);
+    trader.mNow += std::chrono::seconds(1);
+    BOOST_TEST(Quote({{100, 10}, {99, 5}, {98, 5}}) == Expected{"insert 6 BUY 5@98"},
+               boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(LeavesRefusedOrdersForTheNextCall)
+{
+    const std::vector<QuoteLevel> ladder{{100, 1}, {99, 1}, {98, 1}, {97, 1}, {96, 1}};
+    BOOST_TEST(Quote(ladder) == (Expected{"insert 1 BUY 1@100", "insert 2 BUY 1@99", "insert 3 BUY 1@98",
+                                          "insert 4 BUY 1@97"}),
+               boost::test_tools::per_element());
+    BOOST_TEST(Quote(ladder) == Expected{"insert 5 BUY 1@96"}, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(WaitsForScheduledOrders)
+{
+    trader.mHasScheduledOrders = true;
+    BOOST_TEST(quotes.SetQuotes(Side::BUY, std::array<QuoteLevel, 1>{{{100, 10}}}) == 0u);
+    BOOST_TEST(trader.TakeSent().empty());
+    BOOST_TEST(trader.mReleases == 1u);
+
+    trader.mHasScheduledOrders = false;
+    BOOST_TEST(Quote({{100, 10}}) == Expected{"insert 1 BUY 10@100"}, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(KeepsEachSideApart)
+{
+    quotes.SetQuotes(Side::SELL, std::array<QuoteLevel, 1>{{{101, 10}}});
+    BOOST_TEST(trader.TakeSent() == Expected{"insert 1 SELL 10@101"}, boost::test_tools::per_element());
+    BOOST_TEST(Quote({{100, 10}}) == Expected{"insert 2 BUY 10@100"}, boost::test_tools::per_element());
+    BOOST_TEST(quotes.GetQuotedVolume(Side::SELL, 101) == 10ul);
+}
+
+BOOST_AUTO_TEST_SUITE_END()